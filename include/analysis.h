@@ -0,0 +1,59 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <stddef.h>
+
+// Samples taken before this point are TCP ramp-up and ignored by the estimator
+#define WARMUP_SECONDS 2.0
+
+// Throughput sampled at a fixed interval over one test
+typedef struct {
+    double *time_s;        // Sample time since test start
+    double *mbps;          // Throughput during the interval ending at time_s
+    size_t *bytes;         // Bytes transferred during that interval
+    int count;
+    int capacity;
+} ThroughputSeries;
+
+// Token-bucket burst ("speed boost") found in a throughput series
+typedef struct {
+    int detected;
+    double burst_mbps;     // Mean rate while the burst lasted
+    double burst_seconds;  // From test start to the change point
+    double burst_mb;       // Megabytes transferred during the burst
+    double sustained_mbps; // Mean rate after the change point
+    double sustained_seconds;
+} BurstAnalysis;
+
+// Sort values ascending in place
+void sort_doubles(double *values, int count);
+
+// Series lifecycle
+int series_init(ThroughputSeries *series, int initial_capacity);
+int series_append(ThroughputSeries *series, double time_s, double mbps, size_t bytes);
+void series_free(ThroughputSeries *series);
+
+// Classic estimator: mean of the top quartile of post-warm-up samples
+double estimate_speed(const ThroughputSeries *series, int from, int to);
+
+// Look for a single high-to-low step in the post-warm-up samples
+BurstAnalysis analyze_burst(const ThroughputSeries *series);
+
+// Number of samples taken after the warm-up window
+int series_measured_count(const ThroughputSeries *series);
+
+// Coefficient of variation of samples [from, to), -1 when there are too few
+double series_variation(const ThroughputSeries *series, int from, int to);
+
+// Burst analysis of a finished transfer. One that ran out of data ends with
+// its streams finishing one by one, a staircase the change-point search would
+// take for a burst, so only time-bounded runs (ran_out == 0) are analyzed
+BurstAnalysis analyze_transfer(const ThroughputSeries *series, int ran_out);
+
+// Whether a burst has ended and enough stable data follows it to trust the
+// sustained rate. Without a change point, the whole post-warm-up run must
+// have stayed flat for at least flat_seconds.
+int sustained_rate_established(const ThroughputSeries *series, const BurstAnalysis *burst,
+                               double flat_seconds);
+
+#endif // ANALYSIS_H
@@ -0,0 +1,49 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define IPERF3_DEFAULT_PORT 5201
+
+typedef enum {
+    TRANSFER_DOWNLOAD,
+    TRANSFER_UPLOAD
+} TransferDirection;
+
+typedef struct Backend Backend;
+
+// One bulk transfer handed to a backend by the measurement engine
+typedef struct {
+    const char *target;            // URL or iperf3://host[:port]
+    const Backend *backend;        // Backend that moves the bytes
+    TransferDirection direction;
+    int streams;                   // Parallel connections to open
+    int duration_seconds;          // Longest the engine will let the test run
+    size_t upload_bytes;           // Fixed upload body size (HTTP only, 0 = time based)
+    size_t byte_limit;             // Stop after this much payload (0 = no cap)
+    atomic_size_t *bytes;          // Shared counter the engine samples
+    volatile int *running;         // Cleared by the engine to stop the transfer
+    volatile int finished;         // Set by the backend when it ran out of data
+    char error[128];               // Reason for failure, if any
+} TransferJob;
+
+// A way of moving bytes to or from a test server
+struct Backend {
+    const char *name;
+    // Blocks until the job stops or completes, returns 1 on success
+    int (*transfer)(TransferJob *job);
+    // One round-trip probe in milliseconds, -1 on failure
+    double (*probe)(const char *target);
+};
+
+// HTTP(S) via libcurl
+extern const Backend HTTP_BACKEND;
+
+// Native iperf3 protocol client over raw TCP
+extern const Backend IPERF3_BACKEND;
+
+// Backend implied by a target's scheme (iperf3:// or anything curl handles)
+const Backend *backend_for_target(const char *target);
+
+#endif // BACKEND_H
@@ -0,0 +1,62 @@
+#ifndef CPU_MONITOR_H
+#define CPU_MONITOR_H
+
+#include <sys/resource.h>
+
+#define CPU_MAX_THREADS 256
+#define CPU_MAX_CORES 256
+
+// Where the client's CPU went during one test phase
+typedef struct {
+    int client_bound;          // The client, not the link, likely set the result
+    double user_percent;       // Process CPU time (getrusage) as % of one core
+    double system_percent;
+    double thread_percent;     // Mean per-interval busiest thread, % of one core
+    double host_percent;       // All cores, any process
+    double steal_percent;      // Time the hypervisor ran someone else
+    double softirq_percent;    // Busiest core's softirq share (packet processing)
+    int cores;
+    int intervals;             // Samples taken
+    char reason[96];           // What saturated, when client_bound
+} CpuUsage;
+
+// CPU time of one of our threads at the previous sample
+typedef struct {
+    int tid;
+    unsigned long long ticks;
+} ThreadTicks;
+
+// /proc/stat counters of one core (or the whole host)
+typedef struct {
+    unsigned long long busy;
+    unsigned long long total;
+    unsigned long long steal;
+    unsigned long long softirq;
+} CoreTicks;
+
+// Running state between samples
+typedef struct {
+    struct rusage start_usage;
+    double start_time;
+    double last_time;
+    ThreadTicks threads[CPU_MAX_THREADS];
+    int thread_count;
+    CoreTicks host;
+    CoreTicks cores[CPU_MAX_CORES];
+    int core_count;
+    int intervals;
+    int thread_hits, host_hits, steal_hits, softirq_hits;
+    double thread_sum, host_sum, steal_sum, softirq_sum;
+    int softirq_core;          // Core that last crossed the softirq threshold
+} CpuMonitor;
+
+// Take the baseline snapshot at the start of a phase
+void cpu_monitor_begin(CpuMonitor *monitor);
+
+// Record the interval since the previous sample (call alongside throughput sampling)
+void cpu_monitor_sample(CpuMonitor *monitor);
+
+// Close the phase and decide whether it was client-bound
+void cpu_monitor_end(const CpuMonitor *monitor, CpuUsage *usage);
+
+#endif // CPU_MONITOR_H
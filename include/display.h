@@ -3,6 +3,7 @@
 
 #include "network.h"
 #include "ip_info.h"
+#include "udp_probe.h"
 
 // ANSI color codes
 #define COLOR_RESET   "\033[0m"
@@ -18,6 +19,9 @@
 void display_header(void);
 void display_ip_info(const IPInfo *info);
 void display_speed_results(const SpeedTestResult *result);
+void display_udp_results(const UdpProbeResult *result);
+void display_phase_timings(void);
+void display_json_results(const SpeedTestResult *result, const IPInfo *info);
 void display_progress(const char *test_name, int percent);
 void display_error(const char *message);
 void clear_line(void);
@@ -0,0 +1,51 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include "network.h"
+#include "ip_info.h"
+
+#define HISTORY_MAGIC "STHIST01"
+#define HISTORY_VERSION 1
+
+// File header, followed by back-to-back HistoryRecords
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint8_t reserved[48];
+} HistoryHeader;
+
+// One speed test run; fixed 256 bytes so the file can be mmapped as an array
+typedef struct {
+    int64_t timestamp;         // Unix time of the run
+    float download_mbps;
+    float upload_mbps;         // 0 when upload was skipped
+    float latency_ms;          // Minimum request latency
+    float latency_p50_ms;
+    float latency_p90_ms;
+    float rtt_ms;              // TCP handshake RTT
+    float burst_mbps;          // 0 when no burst was detected
+    uint16_t streams;          // Parallel download connections
+    uint8_t flags;             // HISTORY_FLAG_*
+    uint8_t local_hour;        // Hour of day (local time) when the run started
+    char ip[46];
+    char server[80];
+    char isp[90];
+} HistoryRecord;
+
+#define HISTORY_FLAG_SUCCESS 0x01
+#define HISTORY_FLAG_BURST   0x02
+#define HISTORY_FLAG_QUICK   0x04
+#define HISTORY_FLAG_CLIENT_BOUND 0x08
+
+// Path of the history file ($SPEEDTEST_HISTORY, else XDG data dir)
+const char *history_path(void);
+
+// Append one run to the history file, returns 1 on success
+int history_append(const SpeedTestResult *result, const IPInfo *info, int quick_mode);
+
+// "history" subcommand: percentiles, trend and time-of-day breakdown
+int run_history(int argc, char *argv[]);
+
+#endif // HISTORY_H
@@ -2,6 +2,19 @@
 #define NETWORK_H
 
 #include <stddef.h>
+#include <curl/curl.h>
+#include "analysis.h"
+#include "cpu_monitor.h"
+
+// Where the time of a latency probe goes (medians over fresh connections)
+typedef struct {
+    double rtt_ms;         // TCP handshake: pure network round trip (minimum)
+    double dns_ms;         // Name lookup
+    double tls_ms;         // TLS handshake overhead
+    double server_ms;      // Server think time until first byte
+    double p50_ms;         // Request latency percentiles across probes
+    double p90_ms;
+} LatencyBreakdown;
 
 // Structure to hold speed test results
 typedef struct {
@@ -9,8 +22,30 @@ typedef struct {
     double upload_speed_mbps;
     double latency_ms;
     int success;
+    LatencyBreakdown latency_phases;
+    BurstAnalysis download_burst;
+    const char *server_url;    // Download server that was used
+    int streams;               // Parallel download connections
+    CpuUsage download_cpu;     // Client CPU during each transfer
+    CpuUsage upload_cpu;
+    size_t bytes_spent;        // Payload moved by all transfers, probe included
+    size_t byte_budget;        // Data budget the run was planned for (0 = none)
+    int budget_confident;      // The download got enough post-warm-up samples for its variation
 } SpeedTestResult;
 
+// Smallest data budget: the probe needs its 256 KB floor within a quarter of it
+#define BYTE_BUDGET_MIN (1024 * 1024)
+
+// Tunable engine parameters (defaults reproduce the classic run)
+typedef struct {
+    int num_connections;   // Parallel download streams
+    int duration_seconds;  // Download test length
+    int max_duration_seconds; // Extend up to this while a burst hides the sustained rate (0 = off)
+    long http_version;     // CURL_HTTP_VERSION_* value
+    long buffer_size;      // CURLOPT_BUFFERSIZE for download streams
+    size_t byte_budget;    // Payload cap for the whole run (0 = unlimited)
+} TestConfig;
+
 // Callback structure for tracking progress
 typedef struct {
     size_t total_bytes;
@@ -23,14 +58,39 @@ int network_init(void);
 // Cleanup network module
 void network_cleanup(void);
 
-// Run download speed test
-double test_download_speed(const char *url, size_t expected_size);
+// Default engine configuration
+TestConfig network_default_config(void);
+
+// Replace the active engine configuration
+void network_set_config(const TestConfig *config);
+
+// Get the active engine configuration
+const TestConfig *network_get_config(void);
+
+// Number of built-in download servers
+int network_server_count(void);
+
+// URL of built-in download server at index (NULL if out of range)
+const char *network_server_url(int index);
+
+// Use fixed download/upload endpoints instead of the built-in list (NULL keeps the default)
+void network_set_servers(const char *download_url, const char *upload_url);
+
+// Apply the shared DNS/TLS cache and configured HTTP options to a transfer handle
+void network_configure_handle(CURL *curl);
+
+// Prime the shared DNS/TLS cache for a server, returns 1 on success
+int network_warm_up(const char *url);
+
+// Run download speed test (stopping at byte_limit when non-zero), optionally
+// reporting burst analysis and client CPU use
+double test_download_speed(const char *url, size_t byte_limit, BurstAnalysis *burst, CpuUsage *cpu);
 
-// Run upload speed test
-double test_upload_speed(const char *url, size_t data_size);
+// Run upload speed test, optionally reporting client CPU use
+double test_upload_speed(const char *url, size_t data_size, CpuUsage *cpu);
 
-// Measure latency/ping
-double test_latency(const char *url);
+// Measure latency/ping, optionally splitting it into phases
+double test_latency(const char *url, LatencyBreakdown *phases);
 
 // Run full speed test
 SpeedTestResult run_speed_test(void);
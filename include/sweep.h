@@ -0,0 +1,17 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+// Run every combination of a parameter matrix in one process.
+//
+// spec is a ';'-separated list of key=value[,value...] axes:
+//   server=1,3        built-in server numbers (as printed by server selection)
+//   conns=4,8         parallel download connections
+//   duration=6,12     download test length in seconds
+//   http=1.1,2,2tls   HTTP version
+//   buffer=64k,512k   CURLOPT_BUFFERSIZE per stream
+// Axes that are left out use the engine defaults. Each combination runs
+// `repeats` times in shuffled order; with show_timing each run prints its
+// own phase timing table. Returns 1 on success, 0 on bad spec.
+int run_sweep(const char *spec, int repeats, int show_timing);
+
+#endif // SWEEP_H
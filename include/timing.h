@@ -0,0 +1,44 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <curl/curl.h>
+
+#define MAX_TIMING_SERVERS 32
+
+// Time spent in each phase of one request, in milliseconds
+typedef struct {
+    double dns_ms;         // Name lookup
+    double tcp_ms;         // TCP handshake, roughly one network round trip
+    double tls_ms;         // TLS handshake (0 for plain HTTP)
+    double wait_ms;        // Request sent until first response byte
+    double transfer_ms;    // First byte until the end of the transfer
+    double total_ms;
+    int new_connection;    // 0 if the request reused an existing connection
+} PhaseTiming;
+
+// Median phase times for every request made to one host
+typedef struct {
+    char host[128];
+    int requests;
+    int new_connections;
+    double dns_ms;         // Handshake phases are medians over new connections only
+    double tcp_ms;
+    double tls_ms;
+    double wait_ms;
+    double transfer_ms;
+    double total_ms;
+} PhaseSummary;
+
+// Read the phase breakdown of a finished transfer
+PhaseTiming timing_from_handle(CURL *curl);
+
+// Record a finished transfer under its host (thread-safe, skips failed transfers)
+void timing_record(CURL *curl, CURLcode res);
+
+// Fill out with per-host summaries, returns the number of hosts
+int timing_get_summaries(PhaseSummary *out, int max);
+
+// Forget all recorded transfers
+void timing_reset(void);
+
+#endif // TIMING_H
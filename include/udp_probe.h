@@ -0,0 +1,33 @@
+#ifndef UDP_PROBE_H
+#define UDP_PROBE_H
+
+#define UDP_PROBE_DEFAULT_PORT 9797
+#define UDP_PROBE_DEFAULT_RATE 1000
+#define UDP_PROBE_DEFAULT_DURATION 5.0
+#define UDP_PROBE_DEFAULT_PAYLOAD 64
+
+// Structure to hold UDP jitter/loss probe results
+typedef struct {
+    int sent;              // Probes sent
+    int received;          // Unique probes echoed back
+    int duplicates;        // Extra copies of already-received probes
+    int reordered;         // Probes that arrived after a later sequence number
+    double loss_percent;
+    double rtt_min_ms;
+    double rtt_p50_ms;
+    double rtt_p90_ms;
+    double rtt_p99_ms;
+    double rtt_max_ms;
+    double jitter_ms;      // RFC 3550 interarrival jitter over round-trip transit
+    int success;
+    char error[128];       // Why the probe failed, if it did
+} UdpProbeResult;
+
+// Send timestamped probes to an echo responder at "host:port" and measure
+// RTT, jitter, loss and reordering
+UdpProbeResult run_udp_probe(const char *target, int rate_pps, double duration_s, int payload_size);
+
+// Run the bundled echo responder on port (blocks until interrupted)
+int run_udp_echo(int port);
+
+#endif // UDP_PROBE_H
@@ -0,0 +1,210 @@
+#!/bin/bash
+
+# Accuracy validation harness
+#
+# Builds a client and a server network namespace joined by a veth pair,
+# shapes both directions with tc (netem for delay/loss, tbf for rate and
+# queue size), runs the client against a local endpoint and checks that the
+# reported throughput and RTT fall within tolerance of the configured link.
+#
+# Usage: sudo ./scripts/netem-validate.sh
+#
+# Environment:
+#   BIN                 client binary (default ./speedtest)
+#   MATRIX              ';'-separated "rate_mbit rtt_ms loss_pct limit_bytes" cases
+#   TOLERANCE_PCT       allowed throughput error in percent (default 10)
+#   RTT_TOLERANCE_MS    allowed RTT error in milliseconds (default 3)
+#   PORT                server port inside the namespace (default 8080)
+
+set -e
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+BIN="${BIN:-./speedtest}"
+PORT="${PORT:-8080}"
+TOLERANCE_PCT="${TOLERANCE_PCT:-10}"
+RTT_TOLERANCE_MS="${RTT_TOLERANCE_MS:-3}"
+MATRIX="${MATRIX:-10 0 0 64000;50 20 0 256000;100 40 0 1000000;50 80 0.1 500000;20 150 0 400000}"
+
+NS_SRV="st-validate-srv"
+NS_CLI="st-validate-cli"
+DEV_SRV="st-veth-s"
+DEV_CLI="st-veth-c"
+ADDR_SRV="10.77.0.1"
+ADDR_CLI="10.77.0.2"
+
+SERVER_PID=""
+WORKDIR="$(mktemp -d)"
+
+echo -e "${GREEN}Speedtest CLI - Accuracy Validation${NC}\n"
+
+if [ "$EUID" -ne 0 ]; then
+    echo -e "${RED}Please run with sudo or as root${NC}"
+    exit 1
+fi
+
+for cmd in ip tc python3; do
+    command -v "$cmd" >/dev/null 2>&1 || { echo -e "${RED}Missing required command: $cmd${NC}"; exit 1; }
+done
+
+if [ ! -x "$BIN" ]; then
+    echo -e "${RED}Client binary not found: $BIN (run 'make' first)${NC}"
+    exit 1
+fi
+
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null || true
+    ip netns del "$NS_SRV" 2>/dev/null || true
+    ip netns del "$NS_CLI" 2>/dev/null || true
+    rm -rf "$WORKDIR"
+}
+trap cleanup EXIT
+
+# netem is a separate module and missing from some minimal kernels
+HAVE_NETEM=1
+modprobe sch_netem 2>/dev/null || true
+
+setup_namespaces() {
+    ip netns add "$NS_SRV"
+    ip netns add "$NS_CLI"
+    ip link add "$DEV_SRV" netns "$NS_SRV" type veth peer name "$DEV_CLI" netns "$NS_CLI"
+    ip -n "$NS_SRV" addr add "$ADDR_SRV/24" dev "$DEV_SRV"
+    ip -n "$NS_CLI" addr add "$ADDR_CLI/24" dev "$DEV_CLI"
+    ip -n "$NS_SRV" link set lo up
+    ip -n "$NS_CLI" link set lo up
+    ip -n "$NS_SRV" link set "$DEV_SRV" up
+    ip -n "$NS_CLI" link set "$DEV_CLI" up
+
+    if ! ip netns exec "$NS_SRV" tc qdisc add dev "$DEV_SRV" root netem delay 1ms 2>/dev/null; then
+        HAVE_NETEM=0
+        echo -e "${YELLOW}netem is not available: cases with delay or loss will be skipped${NC}\n"
+    fi
+    ip netns exec "$NS_SRV" tc qdisc del dev "$DEV_SRV" root 2>/dev/null || true
+}
+
+# shape <namespace> <device> <rate_mbit> <one_way_delay_ms> <loss_pct> <limit_bytes>
+shape() {
+    local ns="$1" dev="$2" rate="$3" delay="$4" loss="$5" limit="$6"
+    # Bucket depth of ~10 ms at line rate, never below two full-size frames
+    local burst=$(( rate * 1000000 / 8 / 100 ))
+    [ "$burst" -lt 3028 ] && burst=3028
+
+    ip netns exec "$ns" tc qdisc del dev "$dev" root 2>/dev/null || true
+    if [ "$delay" != "0" ] || [ "$loss" != "0" ]; then
+        ip netns exec "$ns" tc qdisc add dev "$dev" root handle 1: netem delay "${delay}ms" loss "${loss}%" limit 100000
+        ip netns exec "$ns" tc qdisc add dev "$dev" parent 1:1 handle 10: tbf rate "${rate}mbit" burst "$burst" limit "$limit"
+    else
+        ip netns exec "$ns" tc qdisc add dev "$dev" root tbf rate "${rate}mbit" burst "$burst" limit "$limit"
+    fi
+}
+
+start_server() {
+    ip netns exec "$NS_SRV" python3 "$SCRIPT_DIR/validate-server.py" "$ADDR_SRV" "$PORT" &
+    SERVER_PID=$!
+    for _ in $(seq 1 50); do
+        if ip netns exec "$NS_CLI" bash -c "exec 3<>/dev/tcp/$ADDR_SRV/$PORT" 2>/dev/null; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    echo -e "${RED}Validation server did not start${NC}"
+    exit 1
+}
+
+# check <result.json> <rate_mbit> <rtt_ms> <loss_pct>: prints verdicts, exits non-zero on failure
+check() {
+    python3 - "$@" "$TOLERANCE_PCT" "$RTT_TOLERANCE_MS" <<'PYEOF'
+import json, math, sys
+
+path, rate, rtt, loss, tol_pct, rtt_tol = sys.argv[1:7]
+rate, rtt, loss = float(rate), float(rtt), float(loss) / 100.0
+tol_pct, rtt_tol = float(tol_pct), float(rtt_tol)
+
+with open(path) as f:
+    result = json.load(f)
+
+MSS = 1448
+# Goodput of a tbf-shaped Ethernet link: TCP payload per on-wire frame
+goodput = rate * MSS / 1514
+
+def expected_tcp(streams):
+    # With random loss, TCP is capped by the Mathis et al. bound per stream
+    if loss <= 0 or rtt <= 0:
+        return goodput
+    mathis = streams * (MSS * 8 / (rtt / 1000.0)) * (1.22 / math.sqrt(loss)) / 1e6
+    return min(goodput, mathis)
+
+failed = False
+
+def verdict(name, measured, expected, ok, unit):
+    global failed
+    failed |= not ok
+    status = "\033[0;32mPASS\033[0m" if ok else "\033[0;31mFAIL\033[0m"
+    print(f"     {status} {name:<9} measured {measured:9.2f} {unit:<4} expected {expected:9.2f} {unit}")
+
+for name, key, streams in (("download", "download_mbps", result.get("streams", 8)),
+                           ("upload", "upload_mbps", 1)):
+    expected = expected_tcp(streams)
+    measured = result.get(key, 0.0)
+    error = abs(measured - expected) / expected * 100.0
+    verdict(name, measured, expected, error <= tol_pct, "Mbps")
+
+measured_rtt = result.get("rtt_ms", 0.0)
+allowed = max(rtt_tol, rtt * tol_pct / 100.0)
+verdict("rtt", measured_rtt, rtt, measured_rtt > 0 and abs(measured_rtt - rtt) <= allowed, "ms")
+
+sys.exit(1 if failed else 0)
+PYEOF
+}
+
+setup_namespaces
+start_server
+
+PASSED=0
+FAILED=0
+SKIPPED=0
+
+IFS=';' read -ra CASES <<< "$MATRIX"
+for case in "${CASES[@]}"; do
+    read -r rate rtt loss limit <<< "$case"
+    label="rate=${rate}mbit rtt=${rtt}ms loss=${loss}% limit=${limit}B"
+
+    if [ "$HAVE_NETEM" -eq 0 ] && { [ "$rtt" != "0" ] || [ "$loss" != "0" ]; }; then
+        echo -e "${YELLOW}SKIP${NC} $label (needs netem)"
+        SKIPPED=$((SKIPPED + 1))
+        continue
+    fi
+
+    echo -e "${YELLOW}CASE${NC} $label"
+
+    # Half the RTT in each direction
+    half_rtt=$(awk "BEGIN { print $rtt / 2 }")
+    shape "$NS_SRV" "$DEV_SRV" "$rate" "$half_rtt" "$loss" "$limit"
+    shape "$NS_CLI" "$DEV_CLI" "$rate" "$half_rtt" "$loss" "$limit"
+
+    output="$WORKDIR/output.txt"
+    if ! ip netns exec "$NS_CLI" "$BIN" \
+            --server "http://$ADDR_SRV:$PORT/__down?bytes=1000000000" \
+            --upload-url "http://$ADDR_SRV:$PORT/__up" \
+            --no-ip-info --no-history --json > "$output"; then
+        echo -e "     ${RED}FAIL${NC} client exited with an error"
+        FAILED=$((FAILED + 1))
+        continue
+    fi
+    tail -n 1 "$output" > "$WORKDIR/result.json"
+
+    if check "$WORKDIR/result.json" "$rate" "$rtt" "$loss"; then
+        PASSED=$((PASSED + 1))
+    else
+        FAILED=$((FAILED + 1))
+    fi
+done
+
+echo ""
+echo -e "Passed: ${GREEN}$PASSED${NC}  Failed: ${RED}$FAILED${NC}  Skipped: ${YELLOW}$SKIPPED${NC}"
+[ "$FAILED" -eq 0 ]
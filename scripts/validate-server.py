@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""Minimal speed test endpoint for the validation harness.
+
+Mimics the Cloudflare endpoints the client uses:
+  GET/HEAD /__down?bytes=N   stream N bytes of zeros
+  POST     /__up             read and discard the request body
+"""
+
+import http.server
+import socketserver
+import sys
+from urllib.parse import parse_qs, urlparse
+
+CHUNK = memoryview(bytes(256 * 1024))
+DEFAULT_BYTES = 100_000_000
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def _download_size(self):
+        query = parse_qs(urlparse(self.path).query)
+        try:
+            return int(query.get("bytes", [DEFAULT_BYTES])[0])
+        except ValueError:
+            return DEFAULT_BYTES
+
+    def do_HEAD(self):
+        self.send_response(200)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(self._download_size()))
+        self.end_headers()
+
+    def do_GET(self):
+        if not self.path.startswith("/__down"):
+            self.send_error(404)
+            return
+        remaining = self._download_size()
+        self.do_HEAD()
+        try:
+            while remaining > 0:
+                n = min(remaining, len(CHUNK))
+                self.wfile.write(CHUNK[:n])
+                remaining -= n
+        except (BrokenPipeError, ConnectionResetError):
+            pass
+
+    def do_POST(self):
+        remaining = int(self.headers.get("Content-Length", "0"))
+        while remaining > 0:
+            data = self.rfile.read(min(remaining, 256 * 1024))
+            if not data:
+                break
+            remaining -= len(data)
+        self.send_response(200)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+
+class Server(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+    # The default backlog of 5 drops SYNs from 8 parallel streams and costs
+    # the late ones a ~1 s retransmit, which skews the numbers under test
+    request_queue_size = 128
+
+
+if __name__ == "__main__":
+    host = sys.argv[1] if len(sys.argv) > 1 else "0.0.0.0"
+    port = int(sys.argv[2]) if len(sys.argv) > 2 else 8080
+    Server((host, port), Handler).serve_forever()
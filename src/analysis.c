@@ -0,0 +1,232 @@
+#include "../include/analysis.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// A burst must be this much faster than what follows it
+#define BURST_MIN_RATIO 1.3
+// ...and the step must explain this share of the sample variance
+#define BURST_MIN_EXPLAINED 0.5
+// Each side of the change point needs at least this many samples
+#define MIN_SEGMENT_SAMPLES 3
+// Post-burst data needed before the sustained rate is trusted
+#define SUSTAINED_MIN_SECONDS 4.0
+// Max coefficient of variation for the sustained tail to count as stable
+#define SUSTAINED_MAX_CV 0.15
+
+int series_init(ThroughputSeries *series, int initial_capacity) {
+    memset(series, 0, sizeof(*series));
+    if (initial_capacity < 16) initial_capacity = 16;
+
+    series->time_s = calloc(initial_capacity, sizeof(double));
+    series->mbps = calloc(initial_capacity, sizeof(double));
+    series->bytes = calloc(initial_capacity, sizeof(size_t));
+    if (!series->time_s || !series->mbps || !series->bytes) {
+        series_free(series);
+        return 0;
+    }
+
+    series->capacity = initial_capacity;
+    return 1;
+}
+
+int series_append(ThroughputSeries *series, double time_s, double mbps, size_t bytes) {
+    if (series->count == series->capacity) {
+        int capacity = series->capacity * 2;
+        double *t = realloc(series->time_s, capacity * sizeof(double));
+        if (t) series->time_s = t;
+        double *m = realloc(series->mbps, capacity * sizeof(double));
+        if (m) series->mbps = m;
+        size_t *b = realloc(series->bytes, capacity * sizeof(size_t));
+        if (b) series->bytes = b;
+        if (!t || !m || !b) return 0;
+        series->capacity = capacity;
+    }
+
+    series->time_s[series->count] = time_s;
+    series->mbps[series->count] = mbps;
+    series->bytes[series->count] = bytes;
+    series->count++;
+    return 1;
+}
+
+void series_free(ThroughputSeries *series) {
+    free(series->time_s);
+    free(series->mbps);
+    free(series->bytes);
+    memset(series, 0, sizeof(*series));
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+void sort_doubles(double *values, int count) {
+    if (count > 1) qsort(values, count, sizeof(double), compare_doubles);
+}
+
+// Index of the first sample past the warm-up window
+static int first_measured_sample(const ThroughputSeries *series) {
+    int i = 0;
+    while (i < series->count && series->time_s[i] <= WARMUP_SECONDS) i++;
+    return i;
+}
+
+int series_measured_count(const ThroughputSeries *series) {
+    return series->count - first_measured_sample(series);
+}
+
+double estimate_speed(const ThroughputSeries *series, int from, int to) {
+    int first = first_measured_sample(series);
+    if (from < first) from = first;
+    if (to > series->count) to = series->count;
+    if (to <= from) return 0.0;
+
+    double *sorted = malloc((to - from) * sizeof(double));
+    if (!sorted) return 0.0;
+
+    int count = 0;
+    for (int i = from; i < to; i++) {
+        if (series->mbps[i] > 0) sorted[count++] = series->mbps[i];
+    }
+
+    double speed = 0.0;
+    if (count > 0) {
+        sort_doubles(sorted, count);
+
+        int idx_75 = (count * 3) / 4;
+        if (idx_75 >= count) idx_75 = count - 1;
+
+        double sum = 0.0;
+        for (int i = idx_75; i < count; i++) sum += sorted[i];
+        speed = sum / (count - idx_75);
+    }
+
+    free(sorted);
+    return speed;
+}
+
+// Sum of squared deviations of mbps[from, to) using prefix sums
+static double segment_sse(const double *sum, const double *sum_sq, int from, int to) {
+    int n = to - from;
+    if (n <= 0) return 0.0;
+    double s = sum[to] - sum[from];
+    double sq = sum_sq[to] - sum_sq[from];
+    return sq - (s * s) / n;
+}
+
+BurstAnalysis analyze_burst(const ThroughputSeries *series) {
+    BurstAnalysis result;
+    memset(&result, 0, sizeof(result));
+
+    int first = first_measured_sample(series);
+    int n = series->count - first;
+    if (n < 2 * MIN_SEGMENT_SAMPLES) return result;
+
+    double *sum = calloc(n + 1, sizeof(double));
+    double *sum_sq = calloc(n + 1, sizeof(double));
+    if (!sum || !sum_sq) {
+        free(sum);
+        free(sum_sq);
+        return result;
+    }
+
+    for (int i = 0; i < n; i++) {
+        double v = series->mbps[first + i];
+        sum[i + 1] = sum[i] + v;
+        sum_sq[i + 1] = sum_sq[i] + v * v;
+    }
+
+    // Best single change point by least squares on the segment means
+    double total_sse = segment_sse(sum, sum_sq, 0, n);
+    double best_sse = total_sse;
+    int best_split = -1;
+    for (int k = MIN_SEGMENT_SAMPLES; k <= n - MIN_SEGMENT_SAMPLES; k++) {
+        double sse = segment_sse(sum, sum_sq, 0, k) + segment_sse(sum, sum_sq, k, n);
+        if (sse < best_sse) {
+            best_sse = sse;
+            best_split = k;
+        }
+    }
+
+    if (best_split > 0 && total_sse > 0) {
+        double before = sum[best_split] / best_split;
+        double after = (sum[n] - sum[best_split]) / (n - best_split);
+        double explained = (total_sse - best_sse) / total_sse;
+
+        if (after > 0 && before >= after * BURST_MIN_RATIO && explained >= BURST_MIN_EXPLAINED) {
+            int change = first + best_split;
+            size_t burst_bytes = 0;
+            for (int i = 0; i < change; i++) burst_bytes += series->bytes[i];
+
+            result.detected = 1;
+            result.burst_mbps = before;
+            result.burst_seconds = series->time_s[change - 1];
+            result.burst_mb = (double)burst_bytes / 1000000.0;
+            // Plain mean: the top-quartile estimator overstates a throttled rate
+            result.sustained_mbps = after;
+            result.sustained_seconds = series->time_s[series->count - 1] - series->time_s[change - 1];
+        }
+    }
+
+    free(sum);
+    free(sum_sq);
+    return result;
+}
+
+BurstAnalysis analyze_transfer(const ThroughputSeries *series, int ran_out) {
+    if (ran_out) {
+        BurstAnalysis none;
+        memset(&none, 0, sizeof(none));
+        return none;
+    }
+    return analyze_burst(series);
+}
+
+int sustained_rate_established(const ThroughputSeries *series, const BurstAnalysis *burst,
+                               double flat_seconds) {
+    if (series->count == 0) return 0;
+
+    double end = series->time_s[series->count - 1];
+
+    // Without a change point a flat tail may be a burst still in progress;
+    // believe it only once the whole post-warm-up run stayed flat long enough
+    if (!burst->detected) {
+        if (end - WARMUP_SECONDS < flat_seconds) return 0;
+        int first = first_measured_sample(series);
+        double cv = series_variation(series, first, series->count);
+        return cv >= 0 && cv <= SUSTAINED_MAX_CV;
+    }
+
+    if (burst->sustained_seconds < SUSTAINED_MIN_SECONDS) return 0;
+    if (end - WARMUP_SECONDS < SUSTAINED_MIN_SECONDS) return 0;
+
+    // The last SUSTAINED_MIN_SECONDS must be flat
+    int from = series->count;
+    while (from > 0 && series->time_s[from - 1] > end - SUSTAINED_MIN_SECONDS) from--;
+    double cv = series_variation(series, from, series->count);
+    return cv >= 0 && cv <= SUSTAINED_MAX_CV;
+}
+
+double series_variation(const ThroughputSeries *series, int from, int to) {
+    if (from < 0) from = 0;
+    if (to > series->count) to = series->count;
+
+    double sum = 0.0, sum_sq = 0.0;
+    int n = 0;
+    for (int i = from; i < to; i++) {
+        sum += series->mbps[i];
+        sum_sq += series->mbps[i] * series->mbps[i];
+        n++;
+    }
+    if (n < MIN_SEGMENT_SAMPLES) return -1.0;
+
+    double mean = sum / n;
+    if (mean <= 0) return -1.0;
+    double variance = sum_sq / n - mean * mean;
+    if (variance < 0) variance = 0;
+
+    return sqrt(variance) / mean;
+}
@@ -0,0 +1,200 @@
+#include "../include/backend.h"
+#include "../include/network.h"
+#include "../include/timing.h"
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per-connection state for one HTTP stream
+typedef struct {
+    TransferJob *job;
+    size_t remaining;      // Body left to send or receive (SIZE_MAX when uncapped)
+    CURLcode result;
+    int started;
+    int capped;            // Stopped on purpose at the byte cap
+} HttpStream;
+
+// Discard callback that updates the shared counter
+static size_t download_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    (void)contents;
+    size_t realsize = size * nmemb;
+    HttpStream *stream = (HttpStream *)userp;
+    atomic_fetch_add(stream->job->bytes, realsize);
+    
+    // Backstop for servers that ignore the Range request
+    if (stream->remaining != SIZE_MAX) {
+        if (realsize > stream->remaining) {
+            stream->remaining = 0;
+            stream->capped = 1;
+            return 0;
+        }
+        stream->remaining -= realsize;
+    }
+    return realsize;
+}
+
+// Upload read callback: generates the body and counts what curl takes
+static size_t upload_read_callback(void *ptr, size_t size, size_t nmemb, void *userp) {
+    HttpStream *stream = (HttpStream *)userp;
+    size_t to_send = size * nmemb;
+    if (to_send > stream->remaining) to_send = stream->remaining;
+    if (to_send > 0) {
+        memset(ptr, 'X', to_send);
+        stream->remaining -= to_send;
+        atomic_fetch_add(stream->job->bytes, to_send);
+    }
+    return to_send;
+}
+
+// Simple discard callback for response bodies
+static size_t discard_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    (void)contents;
+    (void)userp;
+    return size * nmemb;
+}
+
+// Progress callback that checks if test should stop
+static int check_stop_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                               curl_off_t ultotal, curl_off_t ulnow) {
+    (void)dltotal; (void)dlnow; (void)ultotal; (void)ulnow;
+    HttpStream *stream = (HttpStream *)clientp;
+    return *stream->job->running ? 0 : 1;
+}
+
+// Thread function for one parallel connection
+static void *http_stream_thread(void *arg) {
+    HttpStream *stream = (HttpStream *)arg;
+    TransferJob *job = stream->job;
+    const TestConfig *config = network_get_config();
+
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        stream->result = CURLE_FAILED_INIT;
+        return NULL;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, job->target);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, (long)job->duration_seconds + 10);
+    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    network_configure_handle(curl);
+
+    if (job->direction == TRANSFER_DOWNLOAD) {
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, download_write_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, stream);
+        curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, config->buffer_size);
+        if (stream->remaining != SIZE_MAX && stream->remaining > 0) {
+            char range[48];
+            snprintf(range, sizeof(range), "0-%zu", stream->remaining - 1);
+            curl_easy_setopt(curl, CURLOPT_RANGE, range);
+        }
+    } else {
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        // Without a fixed size the body is sent chunked until the engine stops it
+        if (job->upload_bytes > 0) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)stream->remaining);
+        }
+        curl_easy_setopt(curl, CURLOPT_READFUNCTION, upload_read_callback);
+        curl_easy_setopt(curl, CURLOPT_READDATA, stream);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_callback);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, check_stop_callback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, stream);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+
+    stream->result = curl_easy_perform(curl);
+    // Stopping at the byte cap is as deliberate as the engine's stop callback
+    timing_record(curl, stream->capped ? CURLE_ABORTED_BY_CALLBACK : stream->result);
+
+    curl_easy_cleanup(curl);
+    return NULL;
+}
+
+static int http_transfer(TransferJob *job) {
+    int count = job->streams > 0 ? job->streams : 1;
+    // Never more streams than bytes, so every stream has something to move
+    size_t body = job->direction == TRANSFER_UPLOAD ? job->upload_bytes : job->byte_limit;
+    if (body > 0 && body < (size_t)count) count = (int)body;
+    pthread_t *threads = calloc(count, sizeof(pthread_t));
+    HttpStream *streams = calloc(count, sizeof(HttpStream));
+    if (!threads || !streams) {
+        free(threads);
+        free(streams);
+        snprintf(job->error, sizeof(job->error), "out of memory");
+        return 0;
+    }
+
+    int started = 0;
+    for (int i = 0; i < count; i++) {
+        streams[i].job = job;
+        streams[i].result = CURLE_OK;
+        if (body > 0) {
+            // Split the body evenly, the first stream takes the remainder
+            streams[i].remaining = body / count + (i == 0 ? body % count : 0);
+        } else {
+            streams[i].remaining = SIZE_MAX;
+        }
+        streams[i].started = pthread_create(&threads[i], NULL, http_stream_thread, &streams[i]) == 0;
+        started += streams[i].started;
+    }
+
+    int success = 0;
+    CURLcode failure = CURLE_OK;
+    for (int i = 0; i < count; i++) {
+        if (!streams[i].started) continue;
+        pthread_join(threads[i], NULL);
+        if (streams[i].result == CURLE_OK || streams[i].result == CURLE_ABORTED_BY_CALLBACK ||
+            (streams[i].result == CURLE_WRITE_ERROR && streams[i].capped)) {
+            success = 1;
+        } else if (failure == CURLE_OK) {
+            failure = streams[i].result;
+        }
+    }
+    if (!success) {
+        snprintf(job->error, sizeof(job->error), "%s",
+                 started ? curl_easy_strerror(failure) : "could not start transfer threads");
+    }
+
+    job->finished = 1;
+    free(threads);
+    free(streams);
+    return success;
+}
+
+// HEAD request round trip over the shared cache
+static double http_probe(const char *target) {
+    CURL *curl = curl_easy_init();
+    if (!curl) return -1.0;
+
+    curl_easy_setopt(curl, CURLOPT_URL, target);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_callback);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 3L);
+    network_configure_handle(curl);
+
+    double start = get_current_time();
+    CURLcode res = curl_easy_perform(curl);
+    double latency = (get_current_time() - start) * 1000.0;
+    timing_record(curl, res);
+
+    curl_easy_cleanup(curl);
+    return res == CURLE_OK ? latency : -1.0;
+}
+
+const Backend HTTP_BACKEND = {
+    "http",
+    http_transfer,
+    http_probe
+};
+
+const Backend *backend_for_target(const char *target) {
+    if (target && strncmp(target, "iperf3://", 9) == 0) {
+        return &IPERF3_BACKEND;
+    }
+    return &HTTP_BACKEND;
+}
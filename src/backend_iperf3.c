@@ -0,0 +1,466 @@
+#include "../include/backend.h"
+#include "../include/network.h"
+#include <json-c/json.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+// Control channel states, as defined by iperf3
+#define IPERF_TEST_START 1
+#define IPERF_TEST_RUNNING 2
+#define IPERF_TEST_END 4
+#define IPERF_PARAM_EXCHANGE 9
+#define IPERF_CREATE_STREAMS 10
+#define IPERF_SERVER_TERMINATE 11
+#define IPERF_CLIENT_TERMINATE 12
+#define IPERF_EXCHANGE_RESULTS 13
+#define IPERF_DISPLAY_RESULTS 14
+#define IPERF_DONE 16
+#define IPERF_ACCESS_DENIED (-1)
+#define IPERF_SERVER_ERROR (-2)
+
+// 36 characters plus the terminating NUL, sent on every connection
+#define COOKIE_SIZE 37
+#define BLOCK_SIZE 131072
+#define MAX_STREAMS 128
+#define CONNECT_TIMEOUT_MS 3000
+#define CONTROL_TIMEOUT_SECONDS 10
+#define POLL_INTERVAL_MS 100
+// Reads per stream per poll pass, so a slow client still gets back to TEST_END
+#define READS_PER_PASS 4
+
+typedef struct {
+    int fd;
+    int id;                // Stream id the server assigns to this connection
+    size_t bytes;
+} Iperf3Stream;
+
+// Split iperf3://host[:port][/...] (IPv6 hosts in brackets)
+static int parse_target(const char *target, char *host, size_t host_len, char *port, size_t port_len) {
+    const char *p = target;
+    if (strncmp(p, "iperf3://", 9) == 0) p += 9;
+
+    const char *end;
+    if (*p == '[') {
+        end = strchr(++p, ']');
+        if (!end) return 0;
+    } else {
+        end = p + strcspn(p, ":/");
+    }
+
+    size_t n = end - p;
+    if (n == 0 || n >= host_len) return 0;
+    memcpy(host, p, n);
+    host[n] = '\0';
+
+    if (*end == ']') end++;
+    if (*end == ':') {
+        snprintf(port, port_len, "%.*s", (int)strcspn(end + 1, "/"), end + 1);
+    } else {
+        snprintf(port, port_len, "%d", IPERF3_DEFAULT_PORT);
+    }
+    return port[0] != '\0';
+}
+
+// Blocking TCP connect with a timeout, returns the socket or -1.
+// The handshake alone (no name lookup) is timed into connect_ms when given.
+static int connect_tcp(const char *host, const char *port, double *connect_ms) {
+    struct addrinfo hints, *res, *ai;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0) return -1;
+
+    int fd = -1;
+    for (ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        double start = get_current_time();
+        int rc = connect(fd, ai->ai_addr, ai->ai_addrlen);
+        if (rc < 0 && errno == EINPROGRESS) {
+            struct pollfd pfd = { fd, POLLOUT, 0 };
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (poll(&pfd, 1, CONNECT_TIMEOUT_MS) == 1 &&
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+                rc = 0;
+            }
+        }
+        if (rc == 0) {
+            if (connect_ms) *connect_ms = (get_current_time() - start) * 1000.0;
+            fcntl(fd, F_SETFL, flags);
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(res);
+    return fd;
+}
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static int read_all(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static int send_state(int fd, int state) {
+    signed char c = (signed char)state;
+    return write_all(fd, &c, 1);
+}
+
+// JSON messages are a 32-bit big-endian length followed by the text
+static int send_json(int fd, struct json_object *obj) {
+    const char *text = json_object_to_json_string(obj);
+    uint32_t len = htonl((uint32_t)strlen(text));
+    return write_all(fd, &len, sizeof(len)) && write_all(fd, text, strlen(text));
+}
+
+// The server's results are not needed: all counting happens client side
+static int skip_json(int fd) {
+    uint32_t len;
+    if (!read_all(fd, &len, sizeof(len))) return 0;
+    len = ntohl(len);
+
+    char buf[4096];
+    while (len > 0) {
+        size_t n = len < sizeof(buf) ? len : sizeof(buf);
+        if (!read_all(fd, buf, n)) return 0;
+        len -= n;
+    }
+    return 1;
+}
+
+static void make_cookie(char *cookie) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz234567";
+    unsigned char raw[COOKIE_SIZE - 1];
+
+    FILE *f = fopen("/dev/urandom", "rb");
+    if (!f || fread(raw, 1, sizeof(raw), f) != sizeof(raw)) {
+        srand((unsigned)time(NULL) ^ (unsigned)getpid());
+        for (size_t i = 0; i < sizeof(raw); i++) raw[i] = (unsigned char)rand();
+    }
+    if (f) fclose(f);
+
+    for (int i = 0; i < COOKIE_SIZE - 1; i++) {
+        cookie[i] = alphabet[raw[i] % 32];
+    }
+    cookie[COOKIE_SIZE - 1] = '\0';
+}
+
+static int send_parameters(int fd, const TransferJob *job, int streams) {
+    struct json_object *params = json_object_new_object();
+    json_object_object_add(params, "tcp", json_object_new_boolean(1));
+    json_object_object_add(params, "omit", json_object_new_int(0));
+    json_object_object_add(params, "time", json_object_new_int(job->duration_seconds));
+    json_object_object_add(params, "parallel", json_object_new_int(streams));
+    if (job->direction == TRANSFER_DOWNLOAD) {
+        json_object_object_add(params, "reverse", json_object_new_boolean(1));
+    }
+    json_object_object_add(params, "len", json_object_new_int(BLOCK_SIZE));
+    if (job->byte_limit > 0) {
+        // Lets a reverse-mode server stop sending at the cap by itself
+        json_object_object_add(params, "num", json_object_new_int64((int64_t)job->byte_limit));
+    }
+    json_object_object_add(params, "client_version", json_object_new_string("3.9"));
+
+    int ok = send_json(fd, params);
+    json_object_put(params);
+    return ok;
+}
+
+static int send_results(int fd, const Iperf3Stream *streams, int count, double elapsed) {
+    struct json_object *results = json_object_new_object();
+    struct json_object *list = json_object_new_array();
+
+    json_object_object_add(results, "cpu_util_total", json_object_new_double(0.0));
+    json_object_object_add(results, "cpu_util_user", json_object_new_double(0.0));
+    json_object_object_add(results, "cpu_util_system", json_object_new_double(0.0));
+    json_object_object_add(results, "sender_has_retransmits", json_object_new_int(-1));
+
+    for (int i = 0; i < count; i++) {
+        struct json_object *s = json_object_new_object();
+        json_object_object_add(s, "id", json_object_new_int(streams[i].id));
+        json_object_object_add(s, "bytes", json_object_new_int64((int64_t)streams[i].bytes));
+        json_object_object_add(s, "retransmits", json_object_new_int(-1));
+        json_object_object_add(s, "jitter", json_object_new_double(0.0));
+        json_object_object_add(s, "errors", json_object_new_int(0));
+        json_object_object_add(s, "packets", json_object_new_int(0));
+        json_object_object_add(s, "start_time", json_object_new_double(0.0));
+        json_object_object_add(s, "end_time", json_object_new_double(elapsed));
+        json_object_array_add(list, s);
+    }
+    json_object_object_add(results, "streams", list);
+
+    int ok = send_json(fd, results);
+    json_object_put(results);
+    return ok;
+}
+
+static int open_streams(TransferJob *job, const char *host, const char *port, const char *cookie,
+                        Iperf3Stream *streams, int count) {
+    for (int i = 0; i < count; i++) {
+        streams[i].fd = connect_tcp(host, port, NULL);
+        if (streams[i].fd < 0 || !write_all(streams[i].fd, cookie, COOKIE_SIZE)) {
+            snprintf(job->error, sizeof(job->error), "could not open data stream %d", i + 1);
+            return 0;
+        }
+        // iperf3 numbers streams 1, 3, 4, 5... and matches results by id
+        streams[i].id = i == 0 ? 1 : i + 2;
+        fcntl(streams[i].fd, F_SETFL, fcntl(streams[i].fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+    return 1;
+}
+
+// Move data on every ready stream (active until TEST_END is sent), returns the number still open
+static int service_streams(TransferJob *job, Iperf3Stream *streams, int count,
+                           const struct pollfd *pfds, char *buffer, int active) {
+    int open = 0;
+    for (int i = 0; i < count; i++) {
+        if (streams[i].fd < 0) continue;
+        short revents = pfds[i + 1].revents;
+
+        if (job->direction == TRANSFER_DOWNLOAD && (revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t n = 0;
+            int reads = 0;
+            while (reads++ < READS_PER_PASS && (n = recv(streams[i].fd, buffer, BLOCK_SIZE, 0)) > 0) {
+                streams[i].bytes += n;
+                size_t total = atomic_fetch_add(job->bytes, (size_t)n) + (size_t)n;
+                // Let the caller send TEST_END before draining a deep socket buffer
+                if (active && job->byte_limit > 0 && total >= job->byte_limit) break;
+            }
+            if (n > 0) {
+                open++;
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                close(streams[i].fd);
+                streams[i].fd = -1;
+                continue;
+            }
+        } else if (job->direction == TRANSFER_UPLOAD && active && (revents & POLLOUT)) {
+            size_t len = BLOCK_SIZE;
+            if (job->byte_limit > 0) {
+                size_t sent = atomic_load(job->bytes);
+                len = sent >= job->byte_limit ? 0 : job->byte_limit - sent;
+                if (len > BLOCK_SIZE) len = BLOCK_SIZE;
+            }
+            ssize_t n = len > 0 ? send(streams[i].fd, buffer, len, MSG_NOSIGNAL) : 0;
+            if (n > 0) {
+                streams[i].bytes += n;
+                atomic_fetch_add(job->bytes, (size_t)n);
+            } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                close(streams[i].fd);
+                streams[i].fd = -1;
+                continue;
+            }
+        }
+        open++;
+    }
+    return open;
+}
+
+// Drive the control state machine until the server says the test is over
+static void run_session(TransferJob *job, int ctrl, const char *host, const char *port,
+                        Iperf3Stream *streams, struct pollfd *pfds, char *buffer, int count) {
+    char cookie[COOKIE_SIZE];
+    make_cookie(cookie);
+    if (!write_all(ctrl, cookie, COOKIE_SIZE)) {
+        snprintf(job->error, sizeof(job->error), "cannot send cookie");
+        return;
+    }
+
+    int done = 0, running = 0, ended = 0;
+    double start = 0.0, stop = 0.0, last_control = get_current_time();
+
+    while (!done) {
+        double now = get_current_time();
+
+        int capped = job->byte_limit > 0 && atomic_load(job->bytes) >= job->byte_limit;
+        if (running && !ended && (!*job->running || capped || now - start >= job->duration_seconds)) {
+            if (!send_state(ctrl, IPERF_TEST_END)) {
+                snprintf(job->error, sizeof(job->error), "lost control connection");
+                return;
+            }
+            ended = 1;
+            stop = now;
+            last_control = now;
+        }
+        if ((!running || ended) && now - last_control > CONTROL_TIMEOUT_SECONDS) {
+            snprintf(job->error, sizeof(job->error), "timed out waiting for server");
+            return;
+        }
+
+        pfds[0].fd = ctrl;
+        pfds[0].events = POLLIN;
+        for (int i = 0; i < count; i++) {
+            pfds[i + 1].fd = streams[i].fd;
+            // Keep draining after TEST_END so the server is never stuck on a full window
+            pfds[i + 1].events = job->direction == TRANSFER_DOWNLOAD ? POLLIN :
+                                 (running && !ended ? POLLOUT : 0);
+            pfds[i + 1].revents = 0;
+        }
+
+        int ready = poll(pfds, count + 1, POLL_INTERVAL_MS);
+        if (ready < 0 && errno != EINTR) {
+            snprintf(job->error, sizeof(job->error), "poll failed: %s", strerror(errno));
+            return;
+        }
+        if (ready <= 0) continue;
+
+        if (running) {
+            service_streams(job, streams, count, pfds, buffer, !ended);
+        }
+        if (!(pfds[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+        signed char state;
+        if (!read_all(ctrl, &state, 1)) {
+            snprintf(job->error, sizeof(job->error), "server closed the control connection");
+            return;
+        }
+        last_control = get_current_time();
+
+        switch (state) {
+        case IPERF_PARAM_EXCHANGE:
+            if (!send_parameters(ctrl, job, count)) {
+                snprintf(job->error, sizeof(job->error), "cannot send test parameters");
+                return;
+            }
+            break;
+        case IPERF_CREATE_STREAMS:
+            if (!open_streams(job, host, port, cookie, streams, count)) return;
+            break;
+        case IPERF_TEST_START:
+            break;
+        case IPERF_TEST_RUNNING:
+            running = 1;
+            start = get_current_time();
+            break;
+        case IPERF_EXCHANGE_RESULTS:
+            if (!ended) stop = get_current_time();
+            if (!send_results(ctrl, streams, count, stop - start) || !skip_json(ctrl)) {
+                snprintf(job->error, sizeof(job->error), "results exchange failed");
+                return;
+            }
+            break;
+        case IPERF_DISPLAY_RESULTS:
+            send_state(ctrl, IPERF_DONE);
+            done = 1;
+            break;
+        case IPERF_ACCESS_DENIED:
+            snprintf(job->error, sizeof(job->error), "server is busy running a test");
+            return;
+        case IPERF_SERVER_ERROR: {
+            int32_t codes[2] = { 0, 0 };
+            read_all(ctrl, codes, sizeof(codes));
+            snprintf(job->error, sizeof(job->error), "server error %d (errno %d)",
+                     (int)ntohl(codes[0]), (int)ntohl(codes[1]));
+            return;
+        }
+        case IPERF_SERVER_TERMINATE:
+            snprintf(job->error, sizeof(job->error), "server terminated the test");
+            return;
+        default:
+            snprintf(job->error, sizeof(job->error), "unexpected control state %d", state);
+            send_state(ctrl, IPERF_CLIENT_TERMINATE);
+            return;
+        }
+    }
+}
+
+static int iperf3_transfer(TransferJob *job) {
+    char host[256], port[16];
+    if (!parse_target(job->target, host, sizeof(host), port, sizeof(port))) {
+        snprintf(job->error, sizeof(job->error), "invalid iperf3 target");
+        job->finished = 1;
+        return 0;
+    }
+
+    int count = job->streams < 1 ? 1 : (job->streams > MAX_STREAMS ? MAX_STREAMS : job->streams);
+    Iperf3Stream *streams = calloc(count, sizeof(Iperf3Stream));
+    struct pollfd *pfds = calloc(count + 1, sizeof(struct pollfd));
+    char *buffer = calloc(1, BLOCK_SIZE);
+    int ctrl = connect_tcp(host, port, NULL);
+
+    if (!streams || !pfds || !buffer) {
+        snprintf(job->error, sizeof(job->error), "out of memory");
+    } else if (ctrl < 0) {
+        snprintf(job->error, sizeof(job->error), "cannot connect to %.80s:%s", host, port);
+    } else {
+        for (int i = 0; i < count; i++) streams[i].fd = -1;
+
+        // Control messages are tiny; the timeout stops a stalled server from hanging the test
+        struct timeval tv = { CONTROL_TIMEOUT_SECONDS, 0 };
+        setsockopt(ctrl, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(ctrl, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(ctrl, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        run_session(job, ctrl, host, port, streams, pfds, buffer, count);
+
+        for (int i = 0; i < count; i++) {
+            if (streams[i].fd >= 0) close(streams[i].fd);
+        }
+    }
+
+    if (ctrl >= 0) close(ctrl);
+    free(streams);
+    free(pfds);
+    free(buffer);
+
+    job->finished = 1;
+    return job->error[0] == '\0';
+}
+
+// TCP handshake time to the control port (iperf3 logs it as an aborted session)
+static double iperf3_probe(const char *target) {
+    char host[256], port[16];
+    if (!parse_target(target, host, sizeof(host), port, sizeof(port))) return -1.0;
+
+    double latency = -1.0;
+    int fd = connect_tcp(host, port, &latency);
+    if (fd < 0) return -1.0;
+
+    close(fd);
+    return latency;
+}
+
+const Backend IPERF3_BACKEND = {
+    "iperf3",
+    iperf3_transfer,
+    iperf3_probe
+};
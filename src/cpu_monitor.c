@@ -0,0 +1,215 @@
+#include "../include/cpu_monitor.h"
+#include "../include/network.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// Share of one sample interval that counts as saturated
+#define THREAD_SATURATED 0.90
+#define HOST_SATURATED 0.95
+#define CORE_SATURATED 0.95
+#define SOFTIRQ_DOMINANT 0.50
+#define STEAL_SIGNIFICANT 0.10
+// A condition must hold in this share of the samples to flag the phase
+#define BOUND_MIN_SHARE 0.5
+#define BOUND_MIN_INTERVALS 2
+
+// Read the aggregate and per-core "cpu" lines, returns the core count or -1
+static int read_proc_stat(CoreTicks *host, CoreTicks *cores, int max_cores) {
+    FILE *f = fopen("/proc/stat", "r");
+    if (!f) return -1;
+
+    char line[512];
+    int count = 0;
+    while (fgets(line, sizeof(line), f)) {
+        // The cpu lines come first
+        if (strncmp(line, "cpu", 3) != 0) break;
+
+        char name[16];
+        unsigned long long v[8] = {0};
+        int fields = sscanf(line, "%15s %llu %llu %llu %llu %llu %llu %llu %llu", name,
+                            &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+        if (fields < 5) continue;
+
+        // user nice system idle iowait irq softirq steal (guest is inside user)
+        CoreTicks t;
+        t.total = v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6] + v[7];
+        t.busy = t.total - v[3] - v[4];
+        t.softirq = v[6];
+        t.steal = v[7];
+
+        if (name[3] == '\0') {
+            *host = t;
+        } else if (count < max_cores) {
+            cores[count++] = t;
+        }
+    }
+
+    fclose(f);
+    return count;
+}
+
+// utime + stime of one of our threads in clock ticks
+static unsigned long long read_thread_ticks(int tid) {
+    char path[64], buf[512];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    char *ok = fgets(buf, sizeof(buf), f);
+    fclose(f);
+    if (!ok) return 0;
+
+    // The command name may contain spaces; fields resume after its ')'
+    char *p = strrchr(buf, ')');
+    unsigned long long utime = 0, stime = 0;
+    if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                     &utime, &stime) != 2) {
+        return 0;
+    }
+    return utime + stime;
+}
+
+static double share(unsigned long long part, unsigned long long total) {
+    return total > 0 ? (double)part / (double)total : 0.0;
+}
+
+// Snapshot threads and cores; with record set, score the interval since the last one
+static void take_snapshot(CpuMonitor *monitor, int record) {
+    double now = get_current_time();
+    double interval = now - monitor->last_time;
+    double hz = (double)sysconf(_SC_CLK_TCK);
+
+    // Busiest thread of this process
+    ThreadTicks threads[CPU_MAX_THREADS];
+    int thread_count = 0;
+    unsigned long long busiest = 0;
+    DIR *dir = opendir("/proc/self/task");
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) && thread_count < CPU_MAX_THREADS) {
+            if (entry->d_name[0] == '.') continue;
+            ThreadTicks *t = &threads[thread_count++];
+            t->tid = atoi(entry->d_name);
+            t->ticks = read_thread_ticks(t->tid);
+
+            // Threads born during the interval count from zero
+            unsigned long long previous = 0;
+            for (int i = 0; i < monitor->thread_count; i++) {
+                if (monitor->threads[i].tid == t->tid) {
+                    previous = monitor->threads[i].ticks;
+                    break;
+                }
+            }
+            if (t->ticks > previous && t->ticks - previous > busiest) busiest = t->ticks - previous;
+        }
+        closedir(dir);
+    }
+
+    CoreTicks host;
+    CoreTicks cores[CPU_MAX_CORES];
+    memset(&host, 0, sizeof(host));
+    int core_count = read_proc_stat(&host, cores, CPU_MAX_CORES);
+
+    if (record && interval > 0) {
+        double thread_share = busiest / (interval * hz);
+        double host_share = share(host.busy - monitor->host.busy, host.total - monitor->host.total);
+        double steal_share = share(host.steal - monitor->host.steal, host.total - monitor->host.total);
+
+        // A core pinned by packet processing caps throughput on small CPEs
+        double softirq_share = 0.0;
+        int softirq_core = -1;
+        for (int i = 0; i < core_count && i < monitor->core_count; i++) {
+            unsigned long long total = cores[i].total - monitor->cores[i].total;
+            double busy = share(cores[i].busy - monitor->cores[i].busy, total);
+            double softirq = share(cores[i].softirq - monitor->cores[i].softirq, total);
+            if (softirq > softirq_share) softirq_share = softirq;
+            if (busy >= CORE_SATURATED && softirq >= SOFTIRQ_DOMINANT * busy) softirq_core = i;
+        }
+
+        monitor->intervals++;
+        monitor->thread_sum += thread_share;
+        monitor->host_sum += host_share;
+        monitor->steal_sum += steal_share;
+        monitor->softirq_sum += softirq_share;
+        if (thread_share >= THREAD_SATURATED) monitor->thread_hits++;
+        if (host_share >= HOST_SATURATED) monitor->host_hits++;
+        if (steal_share >= STEAL_SIGNIFICANT) monitor->steal_hits++;
+        if (softirq_core >= 0) {
+            monitor->softirq_hits++;
+            monitor->softirq_core = softirq_core;
+        }
+    }
+
+    memcpy(monitor->threads, threads, thread_count * sizeof(ThreadTicks));
+    monitor->thread_count = thread_count;
+    monitor->host = host;
+    if (core_count > 0) {
+        memcpy(monitor->cores, cores, core_count * sizeof(CoreTicks));
+        monitor->core_count = core_count;
+    }
+    monitor->last_time = now;
+}
+
+void cpu_monitor_begin(CpuMonitor *monitor) {
+    memset(monitor, 0, sizeof(*monitor));
+    getrusage(RUSAGE_SELF, &monitor->start_usage);
+    monitor->start_time = get_current_time();
+    monitor->last_time = monitor->start_time;
+    monitor->softirq_core = -1;
+    take_snapshot(monitor, 0);
+}
+
+void cpu_monitor_sample(CpuMonitor *monitor) {
+    take_snapshot(monitor, 1);
+}
+
+static double timeval_diff(const struct timeval *end, const struct timeval *start) {
+    return (end->tv_sec - start->tv_sec) + (end->tv_usec - start->tv_usec) / 1000000.0;
+}
+
+static int held(const CpuMonitor *monitor, int hits) {
+    return monitor->intervals >= BOUND_MIN_INTERVALS && hits >= monitor->intervals * BOUND_MIN_SHARE;
+}
+
+void cpu_monitor_end(const CpuMonitor *monitor, CpuUsage *usage) {
+    memset(usage, 0, sizeof(*usage));
+
+    struct rusage end_usage;
+    getrusage(RUSAGE_SELF, &end_usage);
+    double elapsed = get_current_time() - monitor->start_time;
+    if (elapsed > 0) {
+        usage->user_percent = timeval_diff(&end_usage.ru_utime, &monitor->start_usage.ru_utime) / elapsed * 100.0;
+        usage->system_percent = timeval_diff(&end_usage.ru_stime, &monitor->start_usage.ru_stime) / elapsed * 100.0;
+    }
+
+    usage->cores = monitor->core_count > 0 ? monitor->core_count : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    usage->intervals = monitor->intervals;
+    if (monitor->intervals > 0) {
+        usage->thread_percent = monitor->thread_sum / monitor->intervals * 100.0;
+        usage->host_percent = monitor->host_sum / monitor->intervals * 100.0;
+        usage->steal_percent = monitor->steal_sum / monitor->intervals * 100.0;
+        usage->softirq_percent = monitor->softirq_sum / monitor->intervals * 100.0;
+    }
+
+    // Most specific cause first
+    usage->client_bound = 1;
+    if (held(monitor, monitor->thread_hits)) {
+        snprintf(usage->reason, sizeof(usage->reason), "a client thread used %.0f%% of a core",
+                 usage->thread_percent);
+    } else if (held(monitor, monitor->softirq_hits)) {
+        snprintf(usage->reason, sizeof(usage->reason), "packet processing saturated core %d",
+                 monitor->softirq_core);
+    } else if (held(monitor, monitor->host_hits)) {
+        snprintf(usage->reason, sizeof(usage->reason), "host CPU %.0f%% busy across %d core%s",
+                 usage->host_percent, usage->cores, usage->cores == 1 ? "" : "s");
+    } else if (held(monitor, monitor->steal_hits)) {
+        snprintf(usage->reason, sizeof(usage->reason), "hypervisor steal at %.0f%%",
+                 usage->steal_percent);
+    } else {
+        usage->client_bound = 0;
+    }
+}
@@ -1,4 +1,6 @@
 #include "../include/display.h"
+#include "../include/timing.h"
+#include <json-c/json.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -56,6 +58,16 @@ void display_speed_results(const SpeedTestResult *result) {
             printf(COLOR_RED " (Very Poor)\n");
             printf("                Severe lag, not suitable for real-time activities\n");
         }
+        
+        const LatencyBreakdown *phases = &result->latency_phases;
+        if (phases->rtt_ms > 0 && phases->server_ms == 0 && phases->dns_ms == 0) {
+            // Raw TCP backends measure the round trip alone
+            printf(COLOR_YELLOW "   Network RTT: " COLOR_RESET "%.2f ms (TCP handshake)\n", phases->rtt_ms);
+        } else if (phases->rtt_ms > 0) {
+            printf(COLOR_YELLOW "   Network RTT: " COLOR_RESET "%.2f ms"
+                   " (+ DNS %.2f, TLS %.2f, server %.2f ms)\n",
+                   phases->rtt_ms, phases->dns_ms, phases->tls_ms, phases->server_ms);
+        }
     }
     
     if (result->download_speed_mbps > 0) {
@@ -81,6 +93,14 @@ void display_speed_results(const SpeedTestResult *result) {
             printf(COLOR_RED " (Poor)\n");
             printf("                Very slow, only basic web browsing possible\n");
         }
+        
+        const BurstAnalysis *burst = &result->download_burst;
+        if (burst->detected) {
+            printf(COLOR_BLUE "   Burst:       " COLOR_RESET "%.2f Mbps for %.1fs (%.1f MB), then throttled\n",
+                   burst->burst_mbps, burst->burst_seconds, burst->burst_mb);
+            printf("                Download above is the sustained rate over %.1fs\n",
+                   burst->sustained_seconds);
+        }
     }
     
     if (result->upload_speed_mbps > 0) {
@@ -108,9 +128,141 @@ void display_speed_results(const SpeedTestResult *result) {
         }
     }
     
+    // Numbers this machine could not push past are not the ISP's fault
+    const CpuUsage *phases_cpu[2] = { &result->download_cpu, &result->upload_cpu };
+    const char *phase_names[2] = { "download", "upload" };
+    for (int i = 0; i < 2; i++) {
+        if (!phases_cpu[i]->client_bound) continue;
+        printf(COLOR_RED "   Client-bound:" COLOR_RESET " %s limited by this machine\n", phase_names[i]);
+        printf("                %s (process %.0f%% user, %.0f%% system)\n", phases_cpu[i]->reason,
+               phases_cpu[i]->user_percent, phases_cpu[i]->system_percent);
+    }
+    
+    // Payload only; protocol overhead adds a few percent on the wire
+    if (result->byte_budget > 0) {
+        printf(COLOR_YELLOW "   Data used:   " COLOR_RESET "%.1f MB of %.1f MB budget\n",
+               result->bytes_spent / (1024.0 * 1024.0), result->byte_budget / (1024.0 * 1024.0));
+        if (!result->budget_confident) {
+            printf("                Too little data for this link rate; treat as low confidence\n");
+        }
+    } else if (result->bytes_spent > 0) {
+        printf(COLOR_YELLOW "   Data used:   " COLOR_RESET "%.1f MB\n", result->bytes_spent / (1024.0 * 1024.0));
+    }
+    
+    printf("═════════════════════════════════════════\n\n");
+}
+
+void display_udp_results(const UdpProbeResult *result) {
+    if (!result->success) {
+        char message[160];
+        snprintf(message, sizeof(message), "UDP probe failed: %s",
+                 result->error[0] ? result->error : "received no replies");
+        display_error(message);
+        return;
+    }
+    
+    printf(COLOR_BOLD " UDP Probe Results:\n" COLOR_RESET);
+    printf("═════════════════════════════════════════\n");
+    printf(COLOR_YELLOW "   RTT:         " COLOR_RESET "min %.2f / p50 %.2f / p90 %.2f / p99 %.2f / max %.2f ms\n",
+           result->rtt_min_ms, result->rtt_p50_ms, result->rtt_p90_ms,
+           result->rtt_p99_ms, result->rtt_max_ms);
+    printf(COLOR_YELLOW "   Jitter:      " COLOR_RESET "%.3f ms\n", result->jitter_ms);
+    
+    const char *loss_color = result->loss_percent < 0.1 ? COLOR_GREEN :
+                             result->loss_percent < 1.0 ? COLOR_YELLOW : COLOR_RED;
+    printf(COLOR_YELLOW "   Loss:        " COLOR_RESET "%s%.3f%%" COLOR_RESET " (%d of %d probes)\n",
+           loss_color, result->loss_percent, result->sent - result->received, result->sent);
+    printf(COLOR_YELLOW "   Reordered:   " COLOR_RESET "%d", result->reordered);
+    if (result->duplicates > 0) {
+        printf(", %d duplicates", result->duplicates);
+    }
+    printf("\n");
     printf("═════════════════════════════════════════\n\n");
 }
 
+void display_phase_timings(void) {
+    PhaseSummary summaries[MAX_TIMING_SERVERS];
+    int count = timing_get_summaries(summaries, MAX_TIMING_SERVERS);
+    if (count == 0) return;
+    
+    printf(COLOR_BOLD " Request Phase Timing (median ms):\n" COLOR_RESET);
+    printf("═════════════════════════════════════════════════════════════════════════════════════════════\n");
+    printf("   %-36s %5s %5s %8s %8s %8s %8s %9s\n",
+           "Host", "Reqs", "Conns", "DNS", "TCP/RTT", "TLS", "Wait", "Total");
+    printf("─────────────────────────────────────────────────────────────────────────────────────────────\n");
+    
+    for (int i = 0; i < count; i++) {
+        const PhaseSummary *s = &summaries[i];
+        printf("   %-36.36s %5d %5d %8.2f %8.2f %8.2f %8.2f %9.2f\n",
+               s->host, s->requests, s->new_connections,
+               s->dns_ms, s->tcp_ms, s->tls_ms, s->wait_ms, s->total_ms);
+    }
+    
+    printf("═════════════════════════════════════════════════════════════════════════════════════════════\n");
+    printf("   DNS/TCP/TLS are medians over new connections; TCP handshake ~ one network round trip.\n\n");
+}
+
+static struct json_object *cpu_to_json(const CpuUsage *usage) {
+    struct json_object *obj = json_object_new_object();
+    json_object_object_add(obj, "client_bound", json_object_new_boolean(usage->client_bound));
+    json_object_object_add(obj, "reason", json_object_new_string(usage->reason));
+    json_object_object_add(obj, "user_percent", json_object_new_double(usage->user_percent));
+    json_object_object_add(obj, "system_percent", json_object_new_double(usage->system_percent));
+    json_object_object_add(obj, "thread_percent", json_object_new_double(usage->thread_percent));
+    json_object_object_add(obj, "host_percent", json_object_new_double(usage->host_percent));
+    json_object_object_add(obj, "steal_percent", json_object_new_double(usage->steal_percent));
+    json_object_object_add(obj, "softirq_percent", json_object_new_double(usage->softirq_percent));
+    json_object_object_add(obj, "cores", json_object_new_int(usage->cores));
+    return obj;
+}
+
+void display_json_results(const SpeedTestResult *result, const IPInfo *info) {
+    struct json_object *root = json_object_new_object();
+    struct json_object *burst = json_object_new_object();
+    
+    json_object_object_add(root, "success", json_object_new_boolean(result->success));
+    json_object_object_add(root, "server", json_object_new_string(result->server_url ? result->server_url : ""));
+    json_object_object_add(root, "streams", json_object_new_int(result->streams));
+    json_object_object_add(root, "download_mbps", json_object_new_double(result->download_speed_mbps));
+    json_object_object_add(root, "upload_mbps", json_object_new_double(result->upload_speed_mbps));
+    json_object_object_add(root, "latency_ms", json_object_new_double(result->latency_ms));
+    json_object_object_add(root, "latency_p50_ms", json_object_new_double(result->latency_phases.p50_ms));
+    json_object_object_add(root, "latency_p90_ms", json_object_new_double(result->latency_phases.p90_ms));
+    json_object_object_add(root, "rtt_ms", json_object_new_double(result->latency_phases.rtt_ms));
+    json_object_object_add(root, "dns_ms", json_object_new_double(result->latency_phases.dns_ms));
+    json_object_object_add(root, "tls_ms", json_object_new_double(result->latency_phases.tls_ms));
+    
+    json_object_object_add(burst, "detected", json_object_new_boolean(result->download_burst.detected));
+    json_object_object_add(burst, "burst_mbps", json_object_new_double(result->download_burst.burst_mbps));
+    json_object_object_add(burst, "burst_seconds", json_object_new_double(result->download_burst.burst_seconds));
+    json_object_object_add(burst, "burst_mb", json_object_new_double(result->download_burst.burst_mb));
+    json_object_object_add(burst, "sustained_mbps", json_object_new_double(result->download_burst.sustained_mbps));
+    json_object_object_add(root, "burst", burst);
+    
+    struct json_object *cpu = json_object_new_object();
+    json_object_object_add(cpu, "download", cpu_to_json(&result->download_cpu));
+    json_object_object_add(cpu, "upload", cpu_to_json(&result->upload_cpu));
+    json_object_object_add(root, "client_bound",
+                           json_object_new_boolean(result->download_cpu.client_bound ||
+                                                   result->upload_cpu.client_bound));
+    json_object_object_add(root, "cpu", cpu);
+    
+    json_object_object_add(root, "bytes_spent", json_object_new_int64((int64_t)result->bytes_spent));
+    if (result->byte_budget > 0) {
+        json_object_object_add(root, "byte_budget", json_object_new_int64((int64_t)result->byte_budget));
+        json_object_object_add(root, "budget_confident", json_object_new_boolean(result->budget_confident));
+    }
+    
+    if (info && info->success) {
+        json_object_object_add(root, "ip", json_object_new_string(info->ip));
+        json_object_object_add(root, "isp", json_object_new_string(info->isp));
+    }
+    
+    // Single line so scripts can take the last line of output
+    printf("%s\n", json_object_to_json_string_ext(root, JSON_C_TO_STRING_PLAIN));
+    json_object_put(root);
+}
+
 void display_progress(const char *test_name, int percent) {
     clear_line();
     printf("\r" COLOR_CYAN "%s: " COLOR_RESET "[", test_name);
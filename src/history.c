@@ -0,0 +1,438 @@
+#include "../include/history.h"
+#include "../include/display.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(HistoryHeader) == 64, "HistoryHeader must stay 64 bytes");
+_Static_assert(sizeof(HistoryRecord) == 256, "HistoryRecord must stay 256 bytes");
+
+static char g_history_path[512];
+
+const char *history_path(void) {
+    if (g_history_path[0]) return g_history_path;
+
+    const char *env = getenv("SPEEDTEST_HISTORY");
+    const char *xdg = getenv("XDG_DATA_HOME");
+    const char *home = getenv("HOME");
+
+    if (env && *env) {
+        snprintf(g_history_path, sizeof(g_history_path), "%s", env);
+    } else if (xdg && *xdg) {
+        snprintf(g_history_path, sizeof(g_history_path), "%s/speedtest/history.bin", xdg);
+    } else {
+        snprintf(g_history_path, sizeof(g_history_path), "%s/.local/share/speedtest/history.bin",
+                 home ? home : ".");
+    }
+    return g_history_path;
+}
+
+// mkdir -p for the directory part of path
+static void make_parent_dirs(const char *path) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(tmp, 0755);
+            *p = '/';
+        }
+    }
+}
+
+// Copy a string into a fixed-size record field, truncating if needed
+static void copy_field(char *dst, size_t size, const char *src) {
+    size_t n = strnlen(src, size - 1);
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+// Best effort; anything left behind is trimmed by the next append
+static void drop_partial(int fd, off_t size) {
+    if (ftruncate(fd, size) != 0) return;
+}
+
+int history_append(const SpeedTestResult *result, const IPInfo *info, int quick_mode) {
+    const char *path = history_path();
+    make_parent_dirs(path);
+
+    int fd = open(path, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) return 0;
+
+    // Serialize with concurrent runs so the header is written exactly once
+    flock(fd, LOCK_EX);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return 0;
+    }
+
+    // Never trim or append to a file that is not ours (or not this format);
+    // a header torn before its magic cannot be told apart, so it is refused too
+    if (st.st_size > 0) {
+        HistoryHeader existing;
+        memset(&existing, 0, sizeof(existing));
+        ssize_t got = pread(fd, &existing, sizeof(existing), 0);
+        int ours = got >= (ssize_t)sizeof(existing.magic) &&
+                   memcmp(existing.magic, HISTORY_MAGIC, sizeof(existing.magic)) == 0;
+        if (ours && got == (ssize_t)sizeof(existing)) {
+            ours = existing.version == HISTORY_VERSION && existing.record_size == sizeof(HistoryRecord);
+        }
+        if (!ours) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            return 0;
+        }
+    }
+
+    // A crash or short write mid-append leaves a partial record (or header);
+    // cut it off so everything appended after it stays aligned
+    off_t whole = 0;
+    if (st.st_size >= (off_t)sizeof(HistoryHeader)) {
+        whole = st.st_size - (st.st_size - (off_t)sizeof(HistoryHeader)) % (off_t)sizeof(HistoryRecord);
+    }
+    if (whole != st.st_size && ftruncate(fd, whole) != 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return 0;
+    }
+
+    if (whole == 0) {
+        HistoryHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, HISTORY_MAGIC, sizeof(header.magic));
+        header.version = HISTORY_VERSION;
+        header.record_size = sizeof(HistoryRecord);
+        if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+            drop_partial(fd, 0);
+            flock(fd, LOCK_UN);
+            close(fd);
+            return 0;
+        }
+        whole = sizeof(header);
+    }
+
+    HistoryRecord rec;
+    memset(&rec, 0, sizeof(rec));
+
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+
+    rec.timestamp = (int64_t)now;
+    rec.download_mbps = (float)result->download_speed_mbps;
+    rec.upload_mbps = (float)result->upload_speed_mbps;
+    rec.latency_ms = (float)(result->latency_ms > 0 ? result->latency_ms : 0);
+    rec.latency_p50_ms = (float)result->latency_phases.p50_ms;
+    rec.latency_p90_ms = (float)result->latency_phases.p90_ms;
+    rec.rtt_ms = (float)result->latency_phases.rtt_ms;
+    rec.burst_mbps = result->download_burst.detected ? (float)result->download_burst.burst_mbps : 0.0f;
+    rec.streams = (uint16_t)result->streams;
+    rec.local_hour = (uint8_t)local.tm_hour;
+    if (result->success) rec.flags |= HISTORY_FLAG_SUCCESS;
+    if (result->download_burst.detected) rec.flags |= HISTORY_FLAG_BURST;
+    if (quick_mode) rec.flags |= HISTORY_FLAG_QUICK;
+    if (result->download_cpu.client_bound || result->upload_cpu.client_bound) {
+        rec.flags |= HISTORY_FLAG_CLIENT_BOUND;
+    }
+
+    if (result->server_url) copy_field(rec.server, sizeof(rec.server), result->server_url);
+    if (info && info->success) {
+        copy_field(rec.ip, sizeof(rec.ip), info->ip);
+        copy_field(rec.isp, sizeof(rec.isp), info->isp);
+    }
+
+    // One write under the lock; undo a short one rather than leave a torn record
+    int ok = write(fd, &rec, sizeof(rec)) == (ssize_t)sizeof(rec);
+    if (!ok) drop_partial(fd, whole);
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return ok;
+}
+
+#define RADIX_BUCKETS 65536
+#define MAX_PERCENTILES 8
+
+// Exact percentiles of non-negative floats in two linear passes: the bit
+// pattern of a non-negative float orders like an unsigned integer, so a
+// histogram of the high 16 bits finds each target's bucket and a second
+// histogram of the low 16 bits inside that bucket finds the exact value.
+static void percentiles_of(const float *values, size_t n, const double *ps, float *out, int np) {
+    uint32_t *high = calloc(RADIX_BUCKETS, sizeof(uint32_t));
+    uint32_t *low = calloc((size_t)RADIX_BUCKETS * np, sizeof(uint32_t));
+    if (n == 0 || np > MAX_PERCENTILES || !high || !low) {
+        for (int j = 0; j < np; j++) out[j] = 0.0f;
+        free(high);
+        free(low);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t bits;
+        float v = values[i] > 0 ? values[i] : 0.0f;
+        memcpy(&bits, &v, sizeof(bits));
+        high[bits >> 16]++;
+    }
+
+    uint32_t bucket[MAX_PERCENTILES];
+    size_t rank[MAX_PERCENTILES];
+    for (int j = 0; j < np; j++) {
+        size_t k = (size_t)(ps[j] * (n - 1) + 0.5);
+        size_t seen = 0;
+        uint32_t b = 0;
+        while (seen + high[b] <= k) seen += high[b++];
+        bucket[j] = b;
+        rank[j] = k - seen;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t bits;
+        float v = values[i] > 0 ? values[i] : 0.0f;
+        memcpy(&bits, &v, sizeof(bits));
+        for (int j = 0; j < np; j++) {
+            if ((bits >> 16) == bucket[j]) low[(size_t)j * RADIX_BUCKETS + (bits & 0xFFFF)]++;
+        }
+    }
+
+    for (int j = 0; j < np; j++) {
+        const uint32_t *h = low + (size_t)j * RADIX_BUCKETS;
+        size_t seen = 0;
+        uint32_t b = 0;
+        while (seen + h[b] <= rank[j]) seen += h[b++];
+        uint32_t bits = (bucket[j] << 16) | b;
+        memcpy(&out[j], &bits, sizeof(bits));
+    }
+
+    free(high);
+    free(low);
+}
+
+static float median_of(const float *values, size_t n) {
+    static const double half[] = { 0.5 };
+    float median;
+    percentiles_of(values, n, half, &median, 1);
+    return median;
+}
+
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+// First record with timestamp >= since (records are appended in time order)
+static size_t lower_bound(const HistoryRecord *records, size_t count, int64_t since) {
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (records[mid].timestamp < since) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void print_percentile_row(const char *label, const char *unit, const float *values, size_t n) {
+    static const double ps[] = { 0.10, 0.25, 0.50, 0.75, 0.90 };
+    float out[5];
+
+    if (n == 0) {
+        printf("   %-10s %8s\n", label, "no data");
+        return;
+    }
+    percentiles_of(values, n, ps, out, 5);
+    printf("   %-10s %8.2f %8.2f %8.2f %8.2f %8.2f  %s\n", label,
+           out[0], out[1], out[2], out[3], out[4], unit);
+}
+
+static void print_history_usage(void) {
+    printf("Usage: speedtest history [options]\n");
+    printf("\nOptions:\n");
+    printf("  --days N       Only include runs from the last N days\n");
+    printf("  --file PATH    History file (default %s)\n", history_path());
+    printf("\n");
+}
+
+int run_history(int argc, char *argv[]) {
+    int days = 0;
+    const char *path = NULL;
+
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) {
+            days = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_history_usage();
+            return 1;
+        } else {
+            printf("Unknown history option: %s\n", argv[i]);
+            print_history_usage();
+            return 0;
+        }
+    }
+    if (!path) path = history_path();
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        display_error(errno == ENOENT ? "No history recorded yet" : "Cannot open history file");
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(HistoryHeader)) {
+        close(fd);
+        display_error("History file is empty");
+        return 0;
+    }
+
+    // Prefault the whole file at once instead of taking a fault per page
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        display_error("Cannot map history file");
+        return 0;
+    }
+
+    const HistoryHeader *header = map;
+    if (memcmp(header->magic, HISTORY_MAGIC, sizeof(header->magic)) != 0 ||
+        header->record_size != sizeof(HistoryRecord)) {
+        munmap(map, st.st_size);
+        display_error("Unrecognized history file format");
+        return 0;
+    }
+
+    // A torn trailing record (if any) is ignored
+    const HistoryRecord *records = (const HistoryRecord *)((const char *)map + sizeof(HistoryHeader));
+    size_t total = (st.st_size - sizeof(HistoryHeader)) / sizeof(HistoryRecord);
+
+    size_t first = 0;
+    if (days > 0) {
+        first = lower_bound(records, total, (int64_t)time(NULL) - (int64_t)days * 86400);
+    }
+
+    size_t n = total - first;
+    float *download = malloc((n ? n : 1) * sizeof(float));
+    float *upload = malloc((n ? n : 1) * sizeof(float));
+    float *latency = malloc((n ? n : 1) * sizeof(float));
+    float *by_hour = malloc((n ? n : 1) * sizeof(float));
+    unsigned char *hours = malloc(n ? n : 1);
+    if (!download || !upload || !latency || !by_hour || !hours) {
+        free(download);
+        free(upload);
+        free(latency);
+        free(by_hour);
+        free(hours);
+        munmap(map, st.st_size);
+        return 0;
+    }
+
+    size_t n_down = 0, n_up = 0, n_lat = 0, bursts = 0, client_bound = 0;
+    size_t hour_count[24] = {0};
+    double hour_latency_sum[24] = {0};
+    size_t hour_latency_count[24] = {0};
+    double sum_t = 0, sum_y = 0, sum_tt = 0, sum_ty = 0;
+    int64_t t0 = n ? records[first].timestamp : 0;
+
+    // Single pass: gather metrics, per-hour counts and the regression sums
+    for (size_t i = first; i < total; i++) {
+        const HistoryRecord *r = &records[i];
+        if (!(r->flags & HISTORY_FLAG_SUCCESS)) continue;
+
+        hours[n_down] = r->local_hour % 24;
+        download[n_down++] = r->download_mbps;
+        if (r->upload_mbps > 0) upload[n_up++] = r->upload_mbps;
+        if (r->latency_ms > 0) {
+            latency[n_lat++] = r->latency_ms;
+            hour_latency_sum[r->local_hour % 24] += r->latency_ms;
+            hour_latency_count[r->local_hour % 24]++;
+        }
+        if (r->flags & HISTORY_FLAG_BURST) bursts++;
+        if (r->flags & HISTORY_FLAG_CLIENT_BOUND) client_bound++;
+        hour_count[r->local_hour % 24]++;
+
+        double t = (double)(r->timestamp - t0) / 86400.0;
+        sum_t += t;
+        sum_y += r->download_mbps;
+        sum_tt += t * t;
+        sum_ty += t * r->download_mbps;
+    }
+
+    // Group downloads by hour of day for per-hour medians
+    size_t hour_offset[25] = {0};
+    for (int h = 0; h < 24; h++) hour_offset[h + 1] = hour_offset[h] + hour_count[h];
+    size_t hour_fill[24];
+    memcpy(hour_fill, hour_offset, sizeof(hour_fill));
+    for (size_t i = 0; i < n_down; i++) {
+        by_hour[hour_fill[hours[i]]++] = download[i];
+    }
+
+    printf(COLOR_BOLD "\n Speed Test History:\n" COLOR_RESET);
+    printf("═════════════════════════════════════════════════════════════════\n");
+    printf("   File:      %s\n", path);
+
+    if (n_down == 0) {
+        printf("   No successful runs%s\n", days > 0 ? " in the selected range" : "");
+    } else {
+        char from[32], to[32];
+        time_t tf = (time_t)records[first].timestamp;
+        time_t tl = (time_t)records[total - 1].timestamp;
+        strftime(from, sizeof(from), "%Y-%m-%d %H:%M", localtime(&tf));
+        strftime(to, sizeof(to), "%Y-%m-%d %H:%M", localtime(&tl));
+        printf("   Runs:      %zu successful of %zu (%s to %s)\n", n_down, n, from, to);
+        if (bursts > 0) {
+            printf("   Bursts:    detected in %zu runs (%.1f%%)\n", bursts, 100.0 * bursts / n_down);
+        }
+        if (client_bound > 0) {
+            printf("   Client:    CPU-bound in %zu runs (%.1f%%), those measure this machine\n",
+                   client_bound, 100.0 * client_bound / n_down);
+        }
+
+        printf(COLOR_BOLD "\n   %-10s %8s %8s %8s %8s %8s\n" COLOR_RESET, "", "p10", "p25", "p50", "p75", "p90");
+        print_percentile_row("Download", "Mbps", download, n_down);
+        print_percentile_row("Upload", "Mbps", upload, n_up);
+        print_percentile_row("Latency", "ms", latency, n_lat);
+
+        double denom = n_down * sum_tt - sum_t * sum_t;
+        if (n_down > 1 && denom > 0) {
+            double slope = (n_down * sum_ty - sum_t * sum_y) / denom;
+            const char *color = slope >= 0 ? COLOR_GREEN : COLOR_RED;
+            printf("\n   Trend:     %s%+.2f Mbps per week" COLOR_RESET " (download, least squares)\n",
+                   color, slope * 7.0);
+        }
+
+        printf(COLOR_BOLD "\n   Hour   Runs   Median Down   Mean Latency\n" COLOR_RESET);
+        for (int h = 0; h < 24; h++) {
+            if (hour_count[h] == 0) continue;
+            float median = median_of(by_hour + hour_offset[h], hour_count[h]);
+            printf("   %02d:00 %6zu %10.2f Mbps", h, hour_count[h], median);
+            if (hour_latency_count[h] > 0) {
+                printf(" %10.2f ms", hour_latency_sum[h] / hour_latency_count[h]);
+            }
+            printf("\n");
+        }
+    }
+
+    printf("═════════════════════════════════════════════════════════════════\n");
+    printf("   %zu records scanned in %.1f ms\n\n", n, elapsed_ms(&start));
+
+    free(download);
+    free(upload);
+    free(latency);
+    free(by_hour);
+    free(hours);
+    munmap(map, st.st_size);
+    return 1;
+}
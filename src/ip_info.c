@@ -1,4 +1,5 @@
 #include "../include/ip_info.h"
+#include "../include/timing.h"
 #include <curl/curl.h>
 #include <json-c/json.h>
 #include <string.h>
@@ -51,6 +52,7 @@ IPInfo get_ip_info(void) {
     curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
     
     res = curl_easy_perform(curl);
+    timing_record(curl, res);
     
     if (res == CURLE_OK && chunk.data) {
         // Parse JSON response
@@ -4,15 +4,50 @@
 #include "../include/network.h"
 #include "../include/ip_info.h"
 #include "../include/display.h"
+#include "../include/sweep.h"
+#include "../include/udp_probe.h"
+#include "../include/history.h"
 
 
 
+// "50M", "512k", "1.5G" in bytes (powers of 1024), -1 if malformed
+static long long parse_budget(const char *text) {
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value <= 0) return -1;
+    if (*end == 'k' || *end == 'K') value *= 1024;
+    else if (*end == 'm' || *end == 'M') value *= 1024 * 1024;
+    else if (*end == 'g' || *end == 'G') value *= 1024.0 * 1024 * 1024;
+    else if (*end != '\0') return -1;
+    return (long long)value;
+}
+
 void print_usage(const char *program_name) {
     printf("Usage: %s [options]\n", program_name);
+    printf("       %s history [--days N] [--file PATH]\n", program_name);
     printf("\nOptions:\n");
     printf("  -h, --help     Show this help message\n");
     printf("  -v, --version  Show version information\n");
     printf("  -q, --quick    Quick test (download only)\n");
+    printf("  -t, --timing   Show per-host DNS/TCP/TLS/wait timing breakdown\n");
+    printf("  --no-history   Do not append this run to the history file\n");
+    printf("  --server URL   Download from URL instead of picking a built-in server\n");
+    printf("                 (http(s)://... or iperf3://HOST[:PORT])\n");
+    printf("  --upload-url URL  Upload to URL instead of the built-in endpoint\n");
+    printf("  --no-ip-info   Skip the ISP/geolocation lookup\n");
+    printf("  --json         Print the result as one JSON line after the report\n");
+    printf("  --extend [SEC] Extend the download test (up to SEC, default 60) until\n");
+    printf("                 the post-burst sustained rate is established\n");
+    printf("  --budget SIZE  Spend at most SIZE of payload (e.g. 50M, 1G, minimum 1M);\n");
+    printf("                 transfers are sized from a short probe of the link\n");
+    printf("  --sweep SPEC   Run a download parameter matrix, e.g.\n");
+    printf("                 \"server=1,3;conns=4,8;duration=6;http=1.1,2;buffer=64k,512k\"\n");
+    printf("  --repeat N     Runs per sweep combination (default 3)\n");
+    printf("  --udp HOST[:PORT]     UDP jitter/loss probe against an echo responder\n");
+    printf("  --udp-rate PPS        Probe rate in packets per second (default %d)\n", UDP_PROBE_DEFAULT_RATE);
+    printf("  --udp-duration SEC    Probe duration in seconds (default %.0f)\n", UDP_PROBE_DEFAULT_DURATION);
+    printf("  --udp-size BYTES      Probe payload size (default %d)\n", UDP_PROBE_DEFAULT_PAYLOAD);
+    printf("  --udp-echo [PORT]     Run the bundled echo responder (default port %d)\n", UDP_PROBE_DEFAULT_PORT);
     printf("\n");
 }
 
@@ -28,6 +63,23 @@ int g_quick_mode = 0;
 
 int main(int argc, char *argv[]) {
     // int quick_mode = 0;
+    int show_timing = 0;
+    int save_history = 1;
+    int fetch_ip_info = 1;
+    int json_output = 0;
+    const char *server_url = NULL;
+    const char *upload_url = NULL;
+    const char *sweep_spec = NULL;
+    int sweep_repeats = 3;
+    const char *udp_target = NULL;
+    int udp_rate = UDP_PROBE_DEFAULT_RATE;
+    double udp_duration = UDP_PROBE_DEFAULT_DURATION;
+    int udp_payload = UDP_PROBE_DEFAULT_PAYLOAD;
+    
+    // History queries never touch the network
+    if (argc > 1 && strcmp(argv[1], "history") == 0) {
+        return run_history(argc - 2, argv + 2) ? 0 : 1;
+    }
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -39,6 +91,52 @@ int main(int argc, char *argv[]) {
             return 0;
         } else if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quick") == 0) {
             g_quick_mode = 1;
+        } else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "--timing") == 0) {
+            show_timing = 1;
+        } else if (strcmp(argv[i], "--no-history") == 0) {
+            save_history = 0;
+        } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            server_url = argv[++i];
+        } else if (strcmp(argv[i], "--upload-url") == 0 && i + 1 < argc) {
+            upload_url = argv[++i];
+        } else if (strcmp(argv[i], "--no-ip-info") == 0) {
+            fetch_ip_info = 0;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json_output = 1;
+        } else if (strcmp(argv[i], "--extend") == 0) {
+            TestConfig config = *network_get_config();
+            config.max_duration_seconds = 60;
+            if (i + 1 < argc && argv[i + 1][0] != '-') config.max_duration_seconds = atoi(argv[++i]);
+            network_set_config(&config);
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            long long budget = parse_budget(argv[++i]);
+            if (budget < 0) {
+                printf("Invalid budget: %s\n", argv[i]);
+                return 1;
+            }
+            if (budget < BYTE_BUDGET_MIN) {
+                printf("Budget too small: %s (minimum %dM)\n", argv[i], BYTE_BUDGET_MIN / (1024 * 1024));
+                return 1;
+            }
+            TestConfig config = *network_get_config();
+            config.byte_budget = (size_t)budget;
+            network_set_config(&config);
+        } else if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc) {
+            sweep_spec = argv[++i];
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            sweep_repeats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--udp") == 0 && i + 1 < argc) {
+            udp_target = argv[++i];
+        } else if (strcmp(argv[i], "--udp-rate") == 0 && i + 1 < argc) {
+            udp_rate = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--udp-duration") == 0 && i + 1 < argc) {
+            udp_duration = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--udp-size") == 0 && i + 1 < argc) {
+            udp_payload = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--udp-echo") == 0) {
+            int port = UDP_PROBE_DEFAULT_PORT;
+            if (i + 1 < argc && argv[i + 1][0] != '-') port = atoi(argv[++i]);
+            return run_udp_echo(port) ? 0 : 1;
         } else {
             printf("Unknown option: %s\n", argv[i]);
             print_usage(argv[0]);
@@ -52,13 +150,37 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    network_set_servers(server_url, upload_url);
+    
     // Display header
     display_header();
     
+    // Sweep mode runs the matrix and skips the regular report
+    if (sweep_spec) {
+        int ok = run_sweep(sweep_spec, sweep_repeats, show_timing);
+        if (!ok) display_error("Invalid sweep specification");
+        network_cleanup();
+        return ok ? 0 : 1;
+    }
+    
+    // UDP probe mode measures jitter and loss only
+    if (udp_target) {
+        printf(COLOR_BOLD "\n Running UDP Probe:\n" COLOR_RESET);
+        printf("─────────────────────────────────────────────────────────────────────────────────────────────\n");
+        UdpProbeResult udp = run_udp_probe(udp_target, udp_rate, udp_duration, udp_payload);
+        printf("─────────────────────────────────────────────────────────────────────────────────────────────\n\n");
+        display_udp_results(&udp);
+        network_cleanup();
+        return udp.success ? 0 : 1;
+    }
+    
     // Fetch IP and ISP information
-    printf(COLOR_CYAN " Fetching connection information..." COLOR_RESET "\n");
-    IPInfo ip_info = get_ip_info();
-    display_ip_info(&ip_info);
+    IPInfo ip_info = {0};
+    if (fetch_ip_info) {
+        printf(COLOR_CYAN " Fetching connection information..." COLOR_RESET "\n");
+        ip_info = get_ip_info();
+        display_ip_info(&ip_info);
+    }
     
     // Run speed test
     SpeedTestResult result = run_speed_test();
@@ -66,6 +188,17 @@ int main(int argc, char *argv[]) {
     // Display final results
     printf("\n");
     display_speed_results(&result);
+    if (show_timing) {
+        display_phase_timings();
+    }
+    if (json_output) {
+        display_json_results(&result, &ip_info);
+    }
+    
+    // Record the run for later "speedtest history" queries
+    if (save_history && !history_append(&result, &ip_info, g_quick_mode)) {
+        display_error("Could not write history file");
+    }
     
     // Cleanup
     network_cleanup();
@@ -1,5 +1,9 @@
 #include "../include/network.h"
 #include "../include/display.h"
+#include "../include/timing.h"
+#include "../include/analysis.h"
+#include "../include/backend.h"
+#include "../include/cpu_monitor.h"
 #include <curl/curl.h>
 #include <string.h>
 #include <time.h>
@@ -14,41 +18,85 @@
 // External quick mode flag from main.c
 extern int g_quick_mode;
 
+// A test server and the backend that speaks to it
+typedef struct {
+    const Backend *backend;
+    const char *url;
+} ServerEntry;
+
 // Better test servers - includes Asian/Global CDNs
-static const char *DOWNLOAD_TEST_URLS[] = {
+static const ServerEntry DOWNLOAD_SERVERS[] = {
     // Cloudflare (has edge servers in India)
-    "https://speed.cloudflare.com/__down?bytes=100000000",
+    { &HTTP_BACKEND, "https://speed.cloudflare.com/__down?bytes=100000000" },
     // Fast.com Netflix (global CDN, good in India)  
-    "https://ipv4-c001-bom001-jiocinema-isp.1.oca.nflxvideo.net/speedtest/test1mb.bin",
+    { &HTTP_BACKEND, "https://ipv4-c001-bom001-jiocinema-isp.1.oca.nflxvideo.net/speedtest/test1mb.bin" },
     // Singapore servers (closer to India)
-    "http://speedtest.sin1.sg.leaseweb.net/10mb.bin",
+    { &HTTP_BACKEND, "http://speedtest.sin1.sg.leaseweb.net/10mb.bin" },
     // Fallback European servers
-    "http://speedtest.tele2.net/100MB.zip",
-    "http://proof.ovh.net/files/100Mb.dat",
-    NULL
+    { &HTTP_BACKEND, "http://speedtest.tele2.net/100MB.zip" },
+    { &HTTP_BACKEND, "http://proof.ovh.net/files/100Mb.dat" },
+    { NULL, NULL }
 };
 
 // Multiple upload endpoints to test
-static const char *UPLOAD_TEST_URLS[] = {
-    "https://speed.cloudflare.com/__up",
-    NULL
+static const ServerEntry UPLOAD_SERVERS[] = {
+    { &HTTP_BACKEND, "https://speed.cloudflare.com/__up" },
+    { NULL, NULL }
 };
 
 #define NUM_PARALLEL_CONNECTIONS 8
 #define TEST_DURATION_SECONDS 12
+#define DOWNLOAD_BUFFER_SIZE 512000L
+#define SAMPLE_INTERVAL_US 400000
+#define UPLOAD_SIZE_BYTES (25 * 1024 * 1024)
+#define UPLOAD_TIMEOUT_SECONDS 60
+#define LATENCY_PROBES 10
+// --extend: a run with no change point must stay flat this long past the base duration
+#define EXTEND_FLAT_SECONDS 8
 
-// Shared data structure for threads
-typedef struct {
-    const char *url;
-    atomic_size_t bytes_transferred;
-    double start_time;
-    volatile int running;
-    volatile int success;
-} ThreadData;
+// Data-budget planning (see run_speed_test)
+#define BUDGET_PROBE_SHARE 0.05                 // Of the budget spent sizing the link
+#define BUDGET_PROBE_MIN (256 * 1024)
+#define BUDGET_PROBE_MAX (4 * 1024 * 1024)
+#define BUDGET_PROBE_SECONDS 3
+#define BUDGET_HEADROOM 0.95                    // Payload share; headers and retransmits use the rest
+#define BUDGET_DOWNLOAD_SHARE 0.6               // Of what is left after the probe
+#define BUDGET_DOWNLOAD_MAX_SHARE 0.8           // ...when a noisy link needs a longer download
+#define BUDGET_MBPS_PER_STREAM 25.0             // One TCP stream fills about this much
+#define BUDGET_MIN_WINDOW 2.0                   // Seconds of samples wanted after warm-up
+#define BUDGET_TARGET_ERROR 0.05                // Relative standard error aimed for
+#define BUDGET_DEFAULT_CV 0.2                   // Assumed when the probe has too few samples
 
-// Global shared counter for all threads
+// Active engine configuration (see network_set_config)
+static TestConfig g_config = {
+    NUM_PARALLEL_CONNECTIONS,
+    TEST_DURATION_SECONDS,
+    0,
+    CURL_HTTP_VERSION_2_0,
+    DOWNLOAD_BUFFER_SIZE,
+    0
+};
+
+// Endpoints given on the command line (skip server selection when set)
+static const char *g_download_override = NULL;
+static const char *g_upload_override = NULL;
+
+// Share handle so DNS lookups and TLS sessions survive across tests
+static CURLSH *g_share = NULL;
+static pthread_mutex_t g_share_locks[CURL_LOCK_DATA_LAST];
+
+// Global shared counter fed by the active backend
 static atomic_size_t g_total_bytes = 0;
 static volatile int g_test_running = 0;
+// When the active backend returned (read after joining its thread)
+static double g_transfer_end = 0.0;
+// Sample-to-sample variation of the last transfer (-1 with too few samples)
+static double g_transfer_variation = -1.0;
+// Samples the last transfer took past warm-up, and their variation
+static int g_measured_samples = 0;
+static double g_measured_variation = -1.0;
+// Payload moved by every transfer since run_speed_test started
+static size_t g_bytes_spent = 0;
 
 // Get current time
 double get_current_time(void) {
@@ -57,14 +105,15 @@ double get_current_time(void) {
     return tv.tv_sec + tv.tv_usec / 1000000.0;
 }
 
-// Discard callback that updates atomic counter
-static size_t download_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    (void)contents;
-    size_t realsize = size * nmemb;
-    atomic_size_t *bytes = (atomic_size_t *)userp;
-    atomic_fetch_add(bytes, realsize);
-    atomic_fetch_add(&g_total_bytes, realsize);
-    return realsize;
+// Lock callbacks for the share handle
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userp) {
+    (void)handle; (void)access; (void)userp;
+    pthread_mutex_lock(&g_share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userp) {
+    (void)handle; (void)userp;
+    pthread_mutex_unlock(&g_share_locks[data]);
 }
 
 // Simple discard callback for latency tests
@@ -74,136 +123,192 @@ static size_t discard_callback(void *contents, size_t size, size_t nmemb, void *
     return size * nmemb;
 }
 
-// Progress callback that checks if test should stop
-static int check_stop_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
-                               curl_off_t ultotal, curl_off_t ulnow) {
-    (void)dltotal; (void)dlnow; (void)ultotal; (void)ulnow;
-    (void)clientp;
-    return g_test_running ? 0 : 1;
-}
-
-// Thread function for parallel download
-static void *download_thread(void *arg) {
-    ThreadData *data = (ThreadData *)arg;
-    CURL *curl;
-    CURLcode res;
+int network_init(void) {
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        return 0;
+    }
     
-    curl = curl_easy_init();
-    if (!curl) {
-        data->success = 0;
-        data->running = 0;
-        return NULL;
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&g_share_locks[i], NULL);
     }
     
-    data->running = 1;
-    data->success = 0;
-    atomic_store(&data->bytes_transferred, 0);
+    g_share = curl_share_init();
+    if (g_share) {
+        curl_share_setopt(g_share, CURLSHOPT_LOCKFUNC, share_lock);
+        curl_share_setopt(g_share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+        curl_share_setopt(g_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(g_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
     
-    curl_easy_setopt(curl, CURLOPT_URL, data->url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, download_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &data->bytes_transferred);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, TEST_DURATION_SECONDS + 10);
+    return 1;
+}
+
+void network_cleanup(void) {
+    if (g_share) {
+        curl_share_cleanup(g_share);
+        g_share = NULL;
+    }
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_destroy(&g_share_locks[i]);
+    }
+    curl_global_cleanup();
+}
+
+TestConfig network_default_config(void) {
+    TestConfig config = {
+        NUM_PARALLEL_CONNECTIONS,
+        TEST_DURATION_SECONDS,
+        0,
+        CURL_HTTP_VERSION_2_0,
+        DOWNLOAD_BUFFER_SIZE,
+        0
+    };
+    return config;
+}
+
+void network_set_config(const TestConfig *config) {
+    g_config = *config;
+    if (g_config.num_connections < 1) g_config.num_connections = 1;
+    if (g_config.duration_seconds < 3) g_config.duration_seconds = 3;
+    // Below this the probe cap would round to 0, which means "no cap"
+    if (g_config.byte_budget > 0 && g_config.byte_budget < BYTE_BUDGET_MIN) g_config.byte_budget = BYTE_BUDGET_MIN;
+}
+
+const TestConfig *network_get_config(void) {
+    return &g_config;
+}
+
+int network_server_count(void) {
+    int count = 0;
+    while (DOWNLOAD_SERVERS[count].url != NULL) count++;
+    return count;
+}
+
+const char *network_server_url(int index) {
+    if (index < 0 || index >= network_server_count()) return NULL;
+    return DOWNLOAD_SERVERS[index].url;
+}
+
+// Entry for a URL: the tables say which backend serves a built-in server,
+// anything else (--server, --upload-url) is recognized by its scheme
+static ServerEntry server_for_url(const char *url) {
+    const ServerEntry *tables[] = { DOWNLOAD_SERVERS, UPLOAD_SERVERS };
+    for (size_t t = 0; t < sizeof(tables) / sizeof(tables[0]); t++) {
+        for (int i = 0; tables[t][i].url != NULL; i++) {
+            if (strcmp(tables[t][i].url, url) == 0) return tables[t][i];
+        }
+    }
+    ServerEntry entry = { backend_for_target(url), url };
+    return entry;
+}
+
+void network_set_servers(const char *download_url, const char *upload_url) {
+    g_download_override = download_url;
+    g_upload_override = upload_url;
+}
+
+void network_configure_handle(CURL *curl) {
     curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
     curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
-    curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, 512000L);
-    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_0);
-    
-    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, check_stop_callback);
-    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, NULL);
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, g_config.http_version);
+    curl_easy_setopt(curl, CURLOPT_SHARE, g_share);
+}
+
+int network_warm_up(const char *url) {
+    // Only HTTP has a connection-level cache worth priming
+    if (server_for_url(url).backend != &HTTP_BACKEND) return 1;
     
-    res = curl_easy_perform(curl);
+    CURL *curl = curl_easy_init();
+    if (!curl) return 0;
     
-    data->success = (res == CURLE_OK || res == CURLE_ABORTED_BY_CALLBACK);
-    data->running = 0;
+    network_configure_handle(curl);
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_callback);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 3L);
     
+    CURLcode res = curl_easy_perform(curl);
+    timing_record(curl, res);
     curl_easy_cleanup(curl);
-    return NULL;
-}
-
-int network_init(void) {
-    return curl_global_init(CURL_GLOBAL_DEFAULT) == CURLE_OK ? 1 : 0;
-}
-
-void network_cleanup(void) {
-    curl_global_cleanup();
+    
+    return res == CURLE_OK;
 }
 
 // Find best server by latency
-static const char *find_best_server(double *out_latency) {
+static const ServerEntry *find_best_server(double *out_latency) {
     double best_latency = 999999.0;
     int best_index = 0;
     
     printf("   Finding best server");
     fflush(stdout);
     
-    for (int i = 0; DOWNLOAD_TEST_URLS[i] != NULL; i++) {
-        CURL *curl = curl_easy_init();
-        if (!curl) continue;
-        
+    for (int i = 0; DOWNLOAD_SERVERS[i].url != NULL; i++) {
         printf(".");
         fflush(stdout);
         
-        curl_easy_setopt(curl, CURLOPT_URL, DOWNLOAD_TEST_URLS[i]);
-        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_callback);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
-        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 3L);
-        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_0);
-        
-        double start = get_current_time();
-        CURLcode res = curl_easy_perform(curl);
-        double latency = (get_current_time() - start) * 1000.0;
-        
-        if (res == CURLE_OK && latency < best_latency) {
+        double latency = DOWNLOAD_SERVERS[i].backend->probe(DOWNLOAD_SERVERS[i].url);
+        if (latency >= 0 && latency < best_latency) {
             best_latency = latency;
             best_index = i;
         }
-        
-        curl_easy_cleanup(curl);
     }
     
     *out_latency = best_latency;
     printf(" Server %d (%.0fms)\n", best_index + 1, best_latency);
-    return DOWNLOAD_TEST_URLS[best_index];
+    return &DOWNLOAD_SERVERS[best_index];
 }
 
-double test_download_speed(const char *url, size_t expected_size) {
-    (void)expected_size;
-    
-    pthread_t threads[NUM_PARALLEL_CONNECTIONS];
-    ThreadData thread_data[NUM_PARALLEL_CONNECTIONS];
+// Run a backend in a worker thread so the caller can sample its counter
+static void *transfer_thread(void *arg) {
+    TransferJob *job = (TransferJob *)arg;
+    if (!job->backend->transfer(job) && job->error[0] == '\0') {
+        snprintf(job->error, sizeof(job->error), "transfer failed");
+    }
+    g_transfer_end = get_current_time();
+    job->finished = 1;
+    return NULL;
+}
+
+// Sample any backend's byte counter and turn the series into one speed.
+// The test runs for duration seconds, longer (up to max_duration) while a
+// burst still hides the sustained rate, and ends early if the backend runs
+// out of data. Client CPU is sampled alongside the throughput.
+static double measure_transfer(TransferJob *job, const char *label, int duration, int max_duration,
+                               BurstAnalysis *burst, CpuUsage *cpu) {
+    pthread_t worker;
+    ThroughputSeries series;
+    CpuMonitor monitor;
+    CpuUsage usage;
+    if (!series_init(&series, (int)((max_duration * 1000000.0) / SAMPLE_INTERVAL_US) + 1)) {
+        return 0.0;
+    }
     
     atomic_store(&g_total_bytes, 0);
     g_test_running = 1;
-    
-    printf("   Testing download (%d connections)...\n", NUM_PARALLEL_CONNECTIONS);
+    job->bytes = &g_total_bytes;
+    job->running = &g_test_running;
+    job->finished = 0;
+    job->error[0] = '\0';
     
     double global_start = get_current_time();
+    cpu_monitor_begin(&monitor);
     
-    for (int i = 0; i < NUM_PARALLEL_CONNECTIONS; i++) {
-        thread_data[i].url = url;
-        atomic_store(&thread_data[i].bytes_transferred, 0);
-        thread_data[i].start_time = global_start;
-        thread_data[i].running = 0;
-        thread_data[i].success = 0;
-        pthread_create(&threads[i], NULL, download_thread, &thread_data[i]);
+    if (pthread_create(&worker, NULL, transfer_thread, job) != 0) {
+        series_free(&series);
+        return 0.0;
     }
     
     usleep(200000);
     
     size_t last_bytes = 0;
     double last_time = global_start;
-    double speed_samples[30];
-    int sample_count = 0;
+    int extending = 0;
+    int ran_out = 0;
     
     while (1) {
-        usleep(400000);
+        usleep(SAMPLE_INTERVAL_US);
         
         double current_time = get_current_time();
         double elapsed = current_time - global_start;
@@ -216,16 +321,17 @@ double test_download_speed(const char *url, size_t expected_size) {
         
         if (interval > 0 && interval_bytes > 0) {
             instant_speed = ((double)interval_bytes * 8.0 / interval) / 1000000.0;
-            
-            if (elapsed > 2.0 && sample_count < 30) {
-                speed_samples[sample_count++] = instant_speed;
-            }
         }
+        series_append(&series, elapsed, instant_speed, interval_bytes);
+        cpu_monitor_sample(&monitor);
         
-        int percent = (int)((elapsed / TEST_DURATION_SECONDS) * 100);
+        size_t planned = job->upload_bytes > 0 ? job->upload_bytes : job->byte_limit;
+        int percent = planned > 0 ?
+                      (int)(((double)current_bytes / planned) * 100) :
+                      (int)((elapsed / duration) * 100);
         if (percent > 100) percent = 100;
         
-        printf("\r\033[K   Download: %6.2f Mbps [%3d%%] [", instant_speed, percent);
+        printf("\r\033[K   %s %6.2f Mbps [%3d%%] [", label, instant_speed, percent);
         int bars = percent / 2;
         for (int i = 0; i < 50; i++) {
             if (i < bars) printf("=");
@@ -233,161 +339,203 @@ double test_download_speed(const char *url, size_t expected_size) {
             else printf(" ");
         }
         printf("]");
+        if (extending) printf(" extended %.0fs", elapsed);
         fflush(stdout);
         
         last_bytes = current_bytes;
         last_time = current_time;
         
-        if (elapsed >= TEST_DURATION_SECONDS) {
-            g_test_running = 0;
+        if (job->finished) {
+            ran_out = 1;
+            break;
+        }
+        
+        if (elapsed >= duration) {
+            // Keep going while a burst is still masking the sustained rate
+            if (elapsed < max_duration) {
+                BurstAnalysis so_far = analyze_burst(&series);
+                double flat_seconds = duration + EXTEND_FLAT_SECONDS - WARMUP_SECONDS;
+                if (!sustained_rate_established(&series, &so_far, flat_seconds)) {
+                    extending = 1;
+                    continue;
+                }
+            }
             break;
         }
     }
     
-    for (int i = 0; i < NUM_PARALLEL_CONNECTIONS; i++) {
-        pthread_join(threads[i], NULL);
+    g_test_running = 0;
+    pthread_join(worker, NULL);
+    cpu_monitor_end(&monitor, &usage);
+    if (cpu) {
+        *cpu = usage;
+    }
+
+    // A transfer that ran out of data ends with a partial interval and idle
+    // samples while socket buffers drain; neither is the link rate
+    if (ran_out) {
+        while (series.count > 0 && series.bytes[series.count - 1] == 0) series.count--;
+        if (series.count > 0) series.count--;
+    }
+    // The first sample is mostly connection setup and slow start
+    g_transfer_variation = series_variation(&series, 1, series.count);
+    int measured = series_measured_count(&series);
+    g_measured_samples = measured;
+    g_measured_variation = series_variation(&series, series.count - measured, series.count);
+
+    size_t total = atomic_load(&g_total_bytes);
+    g_bytes_spent += total;
+    if (total == 0 || (job->error[0] && job->upload_bytes > 0)) {
+        printf("\r\033[K   %s Failed (%s)\n", label, job->error[0] ? job->error : "no data received");
+        series_free(&series);
+        return 0.0;
     }
     
-    double final_speed = 0.0;
+    double final_speed = estimate_speed(&series, 0, series.count);
     
-    if (sample_count > 0) {
-        for (int i = 0; i < sample_count - 1; i++) {
-            for (int j = i + 1; j < sample_count; j++) {
-                if (speed_samples[i] > speed_samples[j]) {
-                    double tmp = speed_samples[i];
-                    speed_samples[i] = speed_samples[j];
-                    speed_samples[j] = tmp;
-                }
-            }
-        }
-        
-        int idx_75 = (sample_count * 3) / 4;
-        if (idx_75 >= sample_count) idx_75 = sample_count - 1;
-        
-        double sum = 0.0;
-        int count = 0;
-        for (int i = idx_75; i < sample_count; i++) {
-            sum += speed_samples[i];
-            count++;
-        }
-        if (count > 0) {
-            final_speed = sum / count;
-        } else {
-            final_speed = speed_samples[sample_count / 2];
-        }
-    } else {
-        size_t total = atomic_load(&g_total_bytes);
-        double duration = get_current_time() - global_start;
-        if (duration > 2.0) {
-            final_speed = ((double)total * 8.0 / duration) / 1000000.0;
+    // A fixed-size body is timed end to end, and so is a transfer that hit its
+    // byte cap before it had enough samples past warm-up to estimate from
+    int short_window = measured * SAMPLE_INTERVAL_US / 1000000.0 < BUDGET_MIN_WINDOW;
+    if (job->upload_bytes > 0 || (job->byte_limit > 0 && ran_out && short_window)) {
+        final_speed = ((double)total * 8.0 / (g_transfer_end - global_start)) / 1000000.0;
+    }
+    
+    // Too short for post-warm-up samples (small files, capped transfers)
+    if (final_speed <= 0.0) {
+        double elapsed = (ran_out ? g_transfer_end : last_time) - global_start;
+        if (elapsed > 0) {
+            final_speed = ((double)total * 8.0 / elapsed) / 1000000.0;
         }
     }
     
-    printf("\r\033[K   Download: %6.2f Mbps [100%%] [==================================================] DONE\n", final_speed);
+    // A token-bucket burst would otherwise be reported as the line rate
+    BurstAnalysis analysis = analyze_transfer(&series, ran_out);
+    if (analysis.detected) {
+        final_speed = analysis.sustained_mbps;
+    }
+    if (burst) {
+        *burst = analysis;
+    }
+    
+    printf("\r\033[K   %s %6.2f Mbps [100%%] [==================================================] DONE\n", label, final_speed);
+    if (analysis.detected) {
+        printf("   Burst detected: %.2f Mbps for %.1fs (%.1f MB), sustained %.2f Mbps\n",
+               analysis.burst_mbps, analysis.burst_seconds, analysis.burst_mb, analysis.sustained_mbps);
+    }
+    if (usage.client_bound) {
+        printf("   Client-bound: %s, the link may be faster\n", usage.reason);
+    }
     
+    series_free(&series);
     return final_speed;
 }
 
-// Upload read callback
-static size_t upload_read_callback(void *ptr, size_t size, size_t nmemb, void *userp) {
-    size_t *remaining = (size_t *)userp;
-    size_t to_send = size * nmemb;
-    if (to_send > *remaining) to_send = *remaining;
-    if (to_send > 0) {
-        memset(ptr, 'X', to_send);
-        *remaining -= to_send;
+// Download over a given number of streams, stopping at byte_limit when set
+static double run_download(const ServerEntry *server, int streams, size_t byte_limit, BurstAnalysis *burst,
+                           CpuUsage *cpu) {
+    int duration = g_config.duration_seconds;
+    int max_duration = g_config.max_duration_seconds > duration ? g_config.max_duration_seconds : duration;
+    
+    TransferJob job;
+    memset(&job, 0, sizeof(job));
+    job.target = server->url;
+    job.backend = server->backend;
+    job.direction = TRANSFER_DOWNLOAD;
+    job.streams = streams;
+    job.duration_seconds = max_duration;
+    job.byte_limit = byte_limit;
+    
+    if (byte_limit > 0) {
+        printf("   Testing download (%d connections, %.1f MB cap)...\n", job.streams,
+               byte_limit / (1024.0 * 1024.0));
+    } else {
+        printf("   Testing download (%d connections)...\n", job.streams);
     }
-    return to_send;
+    return measure_transfer(&job, "Download:", duration, max_duration, burst, cpu);
 }
 
-// Upload progress data
-typedef struct {
-    double start_time;
-    size_t total_size;
-    double last_speed;
-} UploadProgress;
-
-// Upload progress callback
-static int upload_progress_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
-                                    curl_off_t ultotal, curl_off_t ulnow) {
-    (void)dltotal; (void)dlnow;
-    
-    UploadProgress *prog = (UploadProgress *)clientp;
-    double elapsed = get_current_time() - prog->start_time;
-    
-    if (elapsed > 0.3 && ulnow > 0) {
-        double speed_mbps = ((double)ulnow * 8.0 / elapsed) / 1000000.0;
-        prog->last_speed = speed_mbps;
-        int percent = ultotal > 0 ? (int)((ulnow * 100) / ultotal) : 0;
-        
-        printf("\r\033[K   Upload:   %6.2f Mbps [%3d%%] [", speed_mbps, percent);
-        int bars = percent / 2;
-        for (int i = 0; i < 50; i++) {
-            if (i < bars) printf("=");
-            else if (i == bars) printf(">");
-            else printf(" ");
+// Upload data_size bytes over HTTP, or for the test duration (up to byte_limit) over iperf3
+static double run_upload(const ServerEntry *server, size_t data_size, size_t byte_limit, CpuUsage *cpu) {
+    TransferJob job;
+    memset(&job, 0, sizeof(job));
+    job.target = server->url;
+    job.backend = server->backend;
+    job.direction = TRANSFER_UPLOAD;
+    job.streams = 1;
+    
+    // HTTP posts a fixed body; iperf3 is time based like the download
+    if (server->backend == &HTTP_BACKEND) {
+        job.upload_bytes = byte_limit > 0 && byte_limit < data_size ? byte_limit : data_size;
+        job.duration_seconds = UPLOAD_TIMEOUT_SECONDS;
+        printf("   Testing upload (%.1f MB)...\n", job.upload_bytes / (1024.0 * 1024.0));
+    } else {
+        job.byte_limit = byte_limit;
+        job.duration_seconds = g_config.duration_seconds;
+        if (byte_limit > 0) {
+            printf("   Testing upload (%d seconds, %.1f MB cap)...\n", job.duration_seconds,
+                   byte_limit / (1024.0 * 1024.0));
+        } else {
+            printf("   Testing upload (%d seconds)...\n", job.duration_seconds);
         }
-        printf("]");
-        fflush(stdout);
     }
     
-    return 0;
+    return measure_transfer(&job, "Upload:  ", job.duration_seconds, job.duration_seconds, NULL, cpu);
 }
 
-double test_upload_speed(const char *url, size_t data_size) {
-    CURL *curl;
-    CURLcode res;
-    size_t upload_remaining = data_size;
-    double speed_mbps = 0.0;
-    
-    curl = curl_easy_init();
-    if (!curl) return -1.0;
-    
-    UploadProgress prog = { get_current_time(), data_size, 0.0 };
-    
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)data_size);
-    curl_easy_setopt(curl, CURLOPT_READFUNCTION, upload_read_callback);
-    curl_easy_setopt(curl, CURLOPT_READDATA, &upload_remaining);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard_callback);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);
-    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
-    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_0);
+double test_download_speed(const char *url, size_t byte_limit, BurstAnalysis *burst, CpuUsage *cpu) {
+    ServerEntry server = server_for_url(url);
+    return run_download(&server, g_config.num_connections, byte_limit, burst, cpu);
+}
+
+double test_upload_speed(const char *url, size_t data_size, CpuUsage *cpu) {
+    ServerEntry server = server_for_url(url);
+    return run_upload(&server, data_size, 0, cpu);
+}
+
+// Latency through a non-HTTP backend: only the round trip is visible
+static double probe_latency(const Backend *backend, const char *url, LatencyBreakdown *phases) {
+    double latencies[LATENCY_PROBES];
+    int successful_pings = 0;
     
-    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, upload_progress_callback);
-    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &prog);
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    for (int i = 0; i < LATENCY_PROBES; i++) {
+        double latency = backend->probe(url);
+        if (latency >= 0) latencies[successful_pings++] = latency;
+        usleep(50000);
+    }
     
-    printf("   Testing upload (%zu MB)...\n", data_size / (1024 * 1024));
+    if (successful_pings == 0) {
+        printf("Failed\n");
+        return -1.0;
+    }
     
-    res = curl_easy_perform(curl);
-    double end_time = get_current_time();
+    sort_doubles(latencies, successful_pings);
+    printf("%.2f ms\n", latencies[0]);
     
-    if (res == CURLE_OK) {
-        double duration = end_time - prog.start_time;
-        speed_mbps = ((double)data_size * 8.0 / duration) / 1000000.0;
-        printf("\r\033[K   Upload:   %6.2f Mbps [100%%] [==================================================] DONE\n", speed_mbps);
-    } else {
-        printf("\r\033[K   Upload:   Failed (%s)\n", curl_easy_strerror(res));
+    if (phases) {
+        memset(phases, 0, sizeof(*phases));
+        phases->rtt_ms = latencies[0];
+        phases->p50_ms = latencies[successful_pings / 2];
+        phases->p90_ms = latencies[(successful_pings * 9) / 10];
     }
     
-    curl_easy_cleanup(curl);
-    return speed_mbps;
+    return latencies[0];
 }
 
-double test_latency(const char *url) {
+double test_latency(const char *url, LatencyBreakdown *phases) {
     CURL *curl;
-    double latencies[10];
+    double latencies[LATENCY_PROBES];
+    double rtts[LATENCY_PROBES], dns[LATENCY_PROBES], tls[LATENCY_PROBES], waits[LATENCY_PROBES];
     int successful_pings = 0;
     
     printf("   Testing latency... ");
     fflush(stdout);
     
-    for (int i = 0; i < 10; i++) {
+    const Backend *backend = server_for_url(url).backend;
+    if (backend != &HTTP_BACKEND) {
+        return probe_latency(backend, url, phases);
+    }
+    
+    for (int i = 0; i < LATENCY_PROBES; i++) {
         curl = curl_easy_init();
         if (!curl) continue;
         
@@ -403,8 +551,14 @@ double test_latency(const char *url) {
         double start = get_current_time();
         CURLcode res = curl_easy_perform(curl);
         double latency = (get_current_time() - start) * 1000.0;
+        timing_record(curl, res);
         
         if (res == CURLE_OK) {
+            PhaseTiming t = timing_from_handle(curl);
+            rtts[successful_pings] = t.tcp_ms;
+            dns[successful_pings] = t.dns_ms;
+            tls[successful_pings] = t.tls_ms;
+            waits[successful_pings] = t.wait_ms;
             latencies[successful_pings++] = latency;
         }
         
@@ -417,43 +571,189 @@ double test_latency(const char *url) {
         return -1.0;
     }
     
-    for (int i = 0; i < successful_pings - 1; i++) {
-        for (int j = i + 1; j < successful_pings; j++) {
-            if (latencies[i] > latencies[j]) {
-                double tmp = latencies[i];
-                latencies[i] = latencies[j];
-                latencies[j] = tmp;
-            }
-        }
-    }
+    sort_doubles(latencies, successful_pings);
     
     double min_latency = latencies[0];
     printf("%.2f ms\n", min_latency);
     
+    if (phases) {
+        sort_doubles(rtts, successful_pings);
+        sort_doubles(dns, successful_pings);
+        sort_doubles(tls, successful_pings);
+        sort_doubles(waits, successful_pings);
+        
+        // Minimum handshake is the best estimate of the path RTT; the
+        // overhead phases use medians so one slow lookup does not dominate
+        int mid = successful_pings / 2;
+        phases->rtt_ms = rtts[0];
+        phases->dns_ms = dns[mid];
+        phases->tls_ms = tls[mid];
+        phases->server_ms = waits[mid];
+        phases->p50_ms = latencies[mid];
+        phases->p90_ms = latencies[(successful_pings * 9) / 10];
+    }
+    
     return min_latency;
 }
 
+// How a data budget is split across the run
+typedef struct {
+    size_t download_bytes;
+    size_t upload_bytes;
+    int streams;
+    double probe_mbps;
+} BudgetPlan;
+
+// Seconds of post-warm-up samples a mean needs to reach the target error; the
+// error shrinks with the square root of the sample count
+static double window_needed(double variation) {
+    double samples = (variation / BUDGET_TARGET_ERROR) * (variation / BUDGET_TARGET_ERROR);
+    double needed = samples * SAMPLE_INTERVAL_US / 1000000.0;
+    return needed < BUDGET_MIN_WINDOW ? BUDGET_MIN_WINDOW : needed;
+}
+
+static size_t clamp_size(size_t value, size_t low, size_t high) {
+    if (value < low) return low;
+    if (value > high) return high;
+    return value;
+}
+
+// Size a short capped download, then give the real download as many bytes as
+// the probe's rate and variation say a stable estimate needs
+static BudgetPlan plan_budget(const ServerEntry *server, size_t budget) {
+    BudgetPlan plan;
+    memset(&plan, 0, sizeof(plan));
+    
+    size_t probe_bytes = clamp_size((size_t)(budget * BUDGET_PROBE_SHARE), BUDGET_PROBE_MIN, BUDGET_PROBE_MAX);
+    if (probe_bytes > budget / 4) probe_bytes = budget / 4;
+    
+    TransferJob job;
+    memset(&job, 0, sizeof(job));
+    job.target = server->url;
+    job.backend = server->backend;
+    job.direction = TRANSFER_DOWNLOAD;
+    job.streams = 2;
+    job.duration_seconds = BUDGET_PROBE_SECONDS;
+    job.byte_limit = probe_bytes;
+    
+    printf("   Sizing link (%.1f MB probe)...\n", probe_bytes / (1024.0 * 1024.0));
+    double probe_mbps = measure_transfer(&job, "Probe:   ", BUDGET_PROBE_SECONDS, BUDGET_PROBE_SECONDS, NULL, NULL);
+    plan.probe_mbps = probe_mbps;
+    
+    double variation = g_transfer_variation >= 0 ? g_transfer_variation : BUDGET_DEFAULT_CV;
+    double needed = 0.0, window = 0.0;
+    
+    size_t left = g_bytes_spent < budget ? budget - g_bytes_spent : 0;
+    left = (size_t)(left * BUDGET_HEADROOM);
+    size_t most = g_quick_mode ? left : (size_t)(left * BUDGET_DOWNLOAD_MAX_SHARE);
+    plan.download_bytes = g_quick_mode ? left : (size_t)(left * BUDGET_DOWNLOAD_SHARE);
+    
+    // Only as many streams as the rate needs; each one must get through slow start
+    plan.streams = g_config.num_connections;
+    if (probe_mbps > 0) {
+        int wanted = (int)ceil(probe_mbps / BUDGET_MBPS_PER_STREAM);
+        if (wanted < 1) wanted = 1;
+        if (wanted < plan.streams) plan.streams = wanted;
+        
+        // A noisier probe asks for a longer window after warm-up
+        needed = window_needed(variation);
+        
+        // No point paying for more than the test duration can use
+        double seconds = WARMUP_SECONDS + needed;
+        if (seconds > g_config.duration_seconds) seconds = g_config.duration_seconds;
+        size_t download = (size_t)(probe_mbps * 1000000.0 / 8.0 * seconds);
+        plan.download_bytes = download < most ? download : most;
+        
+        window = plan.download_bytes * 8.0 / (probe_mbps * 1000000.0) - WARMUP_SECONDS;
+    }
+    
+    // Upload keeps its share; whatever the download did not need is not spent
+    if (!g_quick_mode) {
+        size_t upload_share = left - (size_t)(left * BUDGET_DOWNLOAD_SHARE);
+        plan.upload_bytes = left - plan.download_bytes < upload_share ? left - plan.download_bytes : upload_share;
+    }
+    
+    if (probe_mbps > 0) {
+        printf("   Budget plan: %.1f MB down, %.1f MB up, %d stream%s, ~%.1fs past warm-up"
+               " (%.1fs wanted at %.0f%% variation)\n",
+               plan.download_bytes / (1024.0 * 1024.0), plan.upload_bytes / (1024.0 * 1024.0),
+               plan.streams, plan.streams == 1 ? "" : "s", window > 0 ? window : 0.0, needed,
+               variation * 100.0);
+    }
+    printf("\n");
+    
+    return plan;
+}
+
 SpeedTestResult run_speed_test(void) {
-    SpeedTestResult result = {0.0, 0.0, 0.0, 0};
+    SpeedTestResult result;
+    memset(&result, 0, sizeof(result));
+    g_bytes_spent = 0;
     
     printf(COLOR_BOLD "\n Running Speed Tests:\n" COLOR_RESET);
     printf("─────────────────────────────────────────────────────────────────────────────────────────────\n");
     
-    // Find best server
-    double server_latency;
-    const char *best_server = find_best_server(&server_latency);
+    // Find best server, unless one was given explicitly
+    ServerEntry server;
+    const char *latency_url = "https://www.google.co.in";
+    if (g_download_override) {
+        server = server_for_url(g_download_override);
+        latency_url = g_download_override;
+        printf("   Using %s server %s\n", server.backend->name, server.url);
+    } else {
+        double server_latency;
+        server = *find_best_server(&server_latency);
+    }
     
     // Test latency
-    result.latency_ms = test_latency("https://www.google.co.in");
+    result.latency_ms = test_latency(latency_url, &result.latency_phases);
     
     // Test download
     printf("\n");
-    result.download_speed_mbps = test_download_speed(best_server, 0);
+    BudgetPlan plan;
+    memset(&plan, 0, sizeof(plan));
+    plan.streams = g_config.num_connections;
+    if (g_config.byte_budget > 0) {
+        plan = plan_budget(&server, g_config.byte_budget);
+        result.byte_budget = g_config.byte_budget;
+    }
+    result.server_url = server.url;
+    result.streams = plan.streams;
+    int budget_spent = g_config.byte_budget > 0 && plan.download_bytes == 0;
+    if (budget_spent) {
+        // Data in flight when the probe stopped can use up a small budget
+        printf("   Download: budget spent by the probe, reporting its rate\n");
+        result.download_speed_mbps = plan.probe_mbps;
+    } else {
+        result.download_speed_mbps = run_download(&server, plan.streams, plan.download_bytes,
+                                                  &result.download_burst, &result.download_cpu);
+        // Judged on what the download got, not on what the probe forecast
+        if (g_config.byte_budget > 0 && result.download_speed_mbps > 0) {
+            double variation = g_measured_variation >= 0 ? g_measured_variation : BUDGET_DEFAULT_CV;
+            double got = g_measured_samples * SAMPLE_INTERVAL_US / 1000000.0;
+            double needed = window_needed(variation);
+            result.budget_confident = got >= needed;
+            if (!result.budget_confident) {
+                printf("   Only %.1fs past warm-up (%.1fs wanted at %.0f%% variation); results are low confidence\n",
+                       got, needed, variation * 100.0);
+            }
+        }
+    }
     
-    // Test upload (skip if quick mode)
-    if (!g_quick_mode) {
+    // Test upload (skip if quick mode or the budget is gone)
+    if (g_config.byte_budget > 0 && plan.upload_bytes == 0 && !g_quick_mode) {
+        printf("\n   Upload: Skipped (data budget spent)\n");
+    } else if (!g_quick_mode) {
         printf("\n");
-        result.upload_speed_mbps = test_upload_speed(UPLOAD_TEST_URLS[0], 25 * 1024 * 1024);
+        // An iperf3 server takes the upload too; HTTP download hosts rarely accept POSTs
+        ServerEntry upload = UPLOAD_SERVERS[0];
+        if (g_upload_override) {
+            upload = server_for_url(g_upload_override);
+        } else if (server.backend != &HTTP_BACKEND) {
+            upload = server;
+        }
+        result.upload_speed_mbps = run_upload(&upload, UPLOAD_SIZE_BYTES, plan.upload_bytes,
+                                              &result.upload_cpu);
     } else {
         printf("\n   Upload: Skipped (quick mode)\n");
         result.upload_speed_mbps = 0.0;
@@ -462,6 +762,7 @@ SpeedTestResult run_speed_test(void) {
     printf("─────────────────────────────────────────────────────────────────────────────────────────────\n");
     
     result.success = (result.download_speed_mbps > 0);
+    result.bytes_spent = g_bytes_spent;
     
     return result;
 }
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include "../include/sweep.h"
+#include "../include/network.h"
+#include "../include/display.h"
+#include "../include/timing.h"
+#include <curl/curl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_AXIS_VALUES 16
+
+// Accepted axis ranges; durations below the engine's 3 s floor would be clamped
+#define SWEEP_MAX_CONNS 64
+#define SWEEP_MIN_DURATION 3
+#define SWEEP_MAX_DURATION 300
+#define SWEEP_MIN_BUFFER 1024L                  // CURLOPT_BUFFERSIZE minimum
+#define SWEEP_MAX_BUFFER (10L * 1024 * 1024)    // CURL_MAX_READ_SIZE on current libcurl
+
+// One dimension of the parameter matrix
+typedef struct {
+    int count;
+    long values[MAX_AXIS_VALUES];
+} SweepAxis;
+
+// One parameter combination and the speeds it produced
+typedef struct {
+    int server;
+    TestConfig config;
+    double *speeds;
+    int runs;
+} SweepCombo;
+
+// Two-sided 95% Student t quantiles for 1..30 degrees of freedom
+static const double T_QUANTILES_95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static double t_quantile_95(int df) {
+    if (df < 1) return 0.0;
+    if (df <= 30) return T_QUANTILES_95[df - 1];
+    return 1.960;
+}
+
+// Parse "64k", "1m" or a plain byte count
+static long parse_size(const char *text) {
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value <= 0) return -1;
+    if (*end == 'k' || *end == 'K') value *= 1024;
+    else if (*end == 'm' || *end == 'M') value *= 1024 * 1024;
+    else if (*end != '\0') return -1;
+    return (long)value;
+}
+
+static long parse_http_version(const char *text) {
+    if (strcmp(text, "1.0") == 0) return CURL_HTTP_VERSION_1_0;
+    if (strcmp(text, "1.1") == 0) return CURL_HTTP_VERSION_1_1;
+    if (strcmp(text, "2") == 0 || strcmp(text, "2.0") == 0) return CURL_HTTP_VERSION_2_0;
+    if (strcasecmp(text, "2tls") == 0) return CURL_HTTP_VERSION_2TLS;
+    return -1;
+}
+
+static const char *http_version_label(long version) {
+    switch (version) {
+        case CURL_HTTP_VERSION_1_0: return "1.0";
+        case CURL_HTTP_VERSION_1_1: return "1.1";
+        case CURL_HTTP_VERSION_2_0: return "2";
+        case CURL_HTTP_VERSION_2TLS: return "2tls";
+        default: return "?";
+    }
+}
+
+// Parse one "key=v1,v2" axis into the matching SweepAxis
+static int parse_axis(char *item, SweepAxis *servers, SweepAxis *conns,
+                      SweepAxis *durations, SweepAxis *http, SweepAxis *buffers) {
+    char *eq = strchr(item, '=');
+    if (!eq) return 0;
+    *eq = '\0';
+
+    const char *key = item;
+    SweepAxis *axis;
+    if (strcmp(key, "server") == 0) axis = servers;
+    else if (strcmp(key, "conns") == 0) axis = conns;
+    else if (strcmp(key, "duration") == 0) axis = durations;
+    else if (strcmp(key, "http") == 0) axis = http;
+    else if (strcmp(key, "buffer") == 0) axis = buffers;
+    else {
+        fprintf(stderr, "Unknown sweep axis: %s\n", key);
+        return 0;
+    }
+
+    axis->count = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(eq + 1, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        if (axis->count >= MAX_AXIS_VALUES) {
+            fprintf(stderr, "Too many values for sweep axis %s\n", key);
+            return 0;
+        }
+
+        long value;
+        if (axis == http) {
+            value = parse_http_version(tok);
+        } else if (axis == buffers) {
+            value = parse_size(tok);
+        } else {
+            value = strtol(tok, NULL, 10);
+            if (value <= 0) value = -1;
+        }
+
+        if (value < 0) {
+            fprintf(stderr, "Invalid value for sweep axis %s: %s\n", key, tok);
+            return 0;
+        }
+
+        long low = 1, high = value;
+        if (axis == servers) high = network_server_count();
+        else if (axis == conns) high = SWEEP_MAX_CONNS;
+        else if (axis == durations) { low = SWEEP_MIN_DURATION; high = SWEEP_MAX_DURATION; }
+        else if (axis == buffers) { low = SWEEP_MIN_BUFFER; high = SWEEP_MAX_BUFFER; }
+        if (axis != http && (value < low || value > high)) {
+            fprintf(stderr, "Value for sweep axis %s out of range (%ld-%ld): %s\n", key, low, high, tok);
+            return 0;
+        }
+        axis->values[axis->count++] = value;
+    }
+
+    return axis->count > 0;
+}
+
+static void shuffle(int *items, int count) {
+    for (int i = count - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int tmp = items[i];
+        items[i] = items[j];
+        items[j] = tmp;
+    }
+}
+
+// Buffer size as "512k" when it is a whole number of KiB, bytes otherwise
+static void format_buffer(long bytes, char *out, size_t len) {
+    if (bytes % 1024 == 0) snprintf(out, len, "%ldk", bytes / 1024);
+    else snprintf(out, len, "%ld", bytes);
+}
+
+static void print_sweep_table(const SweepCombo *combos, int combo_count) {
+    int best = -1;
+    double best_mean = 0.0;
+
+    printf(COLOR_BOLD "\n Sweep Results (download, 95%% confidence interval):\n" COLOR_RESET);
+    printf("═════════════════════════════════════════════════════════════════════════════\n");
+    printf("   %-6s %-5s %-4s %-5s %-8s %-4s %10s %10s %10s\n",
+           "Server", "Conns", "Dur", "HTTP", "Buffer", "Runs", "Mean Mbps", "± CI", "Stddev");
+    printf("─────────────────────────────────────────────────────────────────────────────\n");
+
+    for (int c = 0; c < combo_count; c++) {
+        const SweepCombo *combo = &combos[c];
+        double mean = 0.0, stddev = 0.0, ci = 0.0;
+
+        for (int i = 0; i < combo->runs; i++) mean += combo->speeds[i];
+        if (combo->runs > 0) mean /= combo->runs;
+
+        if (combo->runs > 1) {
+            double sq = 0.0;
+            for (int i = 0; i < combo->runs; i++) {
+                double d = combo->speeds[i] - mean;
+                sq += d * d;
+            }
+            stddev = sqrt(sq / (combo->runs - 1));
+            ci = t_quantile_95(combo->runs - 1) * stddev / sqrt(combo->runs);
+        }
+
+        if (combo->runs > 0 && mean > best_mean) {
+            best_mean = mean;
+            best = c;
+        }
+
+        char buffer_label[24];
+        format_buffer(combo->config.buffer_size, buffer_label, sizeof(buffer_label));
+
+        printf("   %-6d %-5d %-4d %-5s %-8s %-4d %10.2f %10.2f %10.2f\n",
+               combo->server, combo->config.num_connections, combo->config.duration_seconds,
+               http_version_label(combo->config.http_version), buffer_label,
+               combo->runs, mean, ci, stddev);
+    }
+
+    printf("═════════════════════════════════════════════════════════════════════════════\n");
+    if (best >= 0) {
+        const SweepCombo *combo = &combos[best];
+        char buffer_label[24];
+        format_buffer(combo->config.buffer_size, buffer_label, sizeof(buffer_label));
+        printf(COLOR_GREEN "   Best: " COLOR_RESET "server=%d conns=%d duration=%d http=%s buffer=%s (%.2f Mbps)\n\n",
+               combo->server, combo->config.num_connections, combo->config.duration_seconds,
+               http_version_label(combo->config.http_version), buffer_label, best_mean);
+    }
+}
+
+int run_sweep(const char *spec, int repeats, int show_timing) {
+    TestConfig defaults = network_default_config();
+    SweepAxis servers = { 1, { 1 } };
+    SweepAxis conns = { 1, { defaults.num_connections } };
+    SweepAxis durations = { 1, { defaults.duration_seconds } };
+    SweepAxis http = { 1, { defaults.http_version } };
+    SweepAxis buffers = { 1, { defaults.buffer_size } };
+
+    if (repeats < 1) repeats = 1;
+
+    char *copy = strdup(spec);
+    if (!copy) return 0;
+
+    char *save = NULL;
+    for (char *item = strtok_r(copy, ";", &save); item; item = strtok_r(NULL, ";", &save)) {
+        if (!parse_axis(item, &servers, &conns, &durations, &http, &buffers)) {
+            free(copy);
+            return 0;
+        }
+    }
+    free(copy);
+
+    int combo_count = servers.count * conns.count * durations.count * http.count * buffers.count;
+    int trial_count = combo_count * repeats;
+    SweepCombo *combos = calloc(combo_count, sizeof(SweepCombo));
+    int *trials = calloc(trial_count, sizeof(int));
+    if (!combos || !trials) {
+        free(combos);
+        free(trials);
+        return 0;
+    }
+
+    // Expand the matrix into its cartesian product
+    int c = 0;
+    for (int s = 0; s < servers.count; s++)
+    for (int n = 0; n < conns.count; n++)
+    for (int d = 0; d < durations.count; d++)
+    for (int h = 0; h < http.count; h++)
+    for (int b = 0; b < buffers.count; b++) {
+        combos[c].server = (int)servers.values[s];
+        combos[c].config = defaults;
+        combos[c].config.num_connections = (int)conns.values[n];
+        combos[c].config.duration_seconds = (int)durations.values[d];
+        combos[c].config.http_version = http.values[h];
+        combos[c].config.buffer_size = buffers.values[b];
+        combos[c].speeds = calloc(repeats, sizeof(double));
+        c++;
+    }
+
+    // Randomize run order so slow drift spreads across all combinations
+    for (int t = 0; t < trial_count; t++) trials[t] = t % combo_count;
+    unsigned int seed = (unsigned int)time(NULL) ^ (unsigned int)getpid();
+    srand(seed);
+    shuffle(trials, trial_count);
+
+    printf(COLOR_BOLD "\n Running Sweep:\n" COLOR_RESET);
+    printf("─────────────────────────────────────────────────────────────────────────────────────────────\n");
+    printf("   %d combinations x %d repeats = %d runs (order seed %u)\n", combo_count, repeats, trial_count, seed);
+
+    // Warm DNS and TLS state once so the first run is not penalized
+    for (int s = 0; s < servers.count; s++) {
+        network_warm_up(network_server_url((int)servers.values[s] - 1));
+    }
+
+    for (int t = 0; t < trial_count; t++) {
+        SweepCombo *combo = &combos[trials[t]];
+
+        // Report what the engine actually runs with, after its own clamping
+        network_set_config(&combo->config);
+        combo->config = *network_get_config();
+
+        char buffer_label[24];
+        format_buffer(combo->config.buffer_size, buffer_label, sizeof(buffer_label));
+        printf("\n   [%d/%d] server=%d conns=%d duration=%d http=%s buffer=%s\n",
+               t + 1, trial_count, combo->server, combo->config.num_connections,
+               combo->config.duration_seconds, http_version_label(combo->config.http_version),
+               buffer_label);
+
+        // Phase timing belongs to one configuration, never pooled across them
+        timing_reset();
+        double speed = test_download_speed(network_server_url(combo->server - 1), 0, NULL, NULL);
+        if (show_timing) {
+            printf("\n");
+            display_phase_timings();
+        }
+        if (speed > 0 && combo->speeds) {
+            combo->speeds[combo->runs++] = speed;
+        }
+    }
+
+    network_set_config(&defaults);
+    printf("─────────────────────────────────────────────────────────────────────────────────────────────\n");
+
+    print_sweep_table(combos, combo_count);
+
+    for (int i = 0; i < combo_count; i++) free(combos[i].speeds);
+    free(combos);
+    free(trials);
+
+    return 1;
+}
@@ -0,0 +1,157 @@
+#include "../include/timing.h"
+#include "../include/analysis.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// All transfers recorded against one host
+typedef struct {
+    char host[128];
+    PhaseTiming *samples;
+    int count;
+    int capacity;
+} HostTimings;
+
+static HostTimings g_hosts[MAX_TIMING_SERVERS];
+static int g_host_count = 0;
+static pthread_mutex_t g_timing_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double phase_ms(curl_off_t from_us, curl_off_t to_us) {
+    if (to_us <= from_us) return 0.0;
+    return (double)(to_us - from_us) / 1000.0;
+}
+
+PhaseTiming timing_from_handle(CURL *curl) {
+    PhaseTiming t;
+    memset(&t, 0, sizeof(t));
+
+    curl_off_t namelookup = 0, connect = 0, appconnect = 0;
+    curl_off_t pretransfer = 0, starttransfer = 0, total = 0;
+    long connects = 0;
+
+    // All of these are cumulative microseconds from the start of the request
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &namelookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appconnect);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &starttransfer);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+
+    t.new_connection = connects > 0;
+    t.dns_ms = phase_ms(0, namelookup);
+    t.tcp_ms = phase_ms(namelookup, connect);
+    t.tls_ms = appconnect > 0 ? phase_ms(connect, appconnect) : 0.0;
+    t.wait_ms = phase_ms(pretransfer, starttransfer);
+    t.transfer_ms = phase_ms(starttransfer, total);
+    t.total_ms = phase_ms(0, total);
+
+    return t;
+}
+
+// Extract "host[:port]" from a URL
+static void host_from_url(const char *url, char *host, size_t len) {
+    const char *start = url ? strstr(url, "://") : NULL;
+    start = start ? start + 3 : (url ? url : "");
+    size_t n = strcspn(start, "/?#");
+    if (n >= len) n = len - 1;
+    memcpy(host, start, n);
+    host[n] = '\0';
+}
+
+void timing_record(CURL *curl, CURLcode res) {
+    if (res != CURLE_OK && res != CURLE_ABORTED_BY_CALLBACK) return;
+
+    PhaseTiming t = timing_from_handle(curl);
+    char *url = NULL;
+    char host[128];
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+    host_from_url(url, host, sizeof(host));
+
+    pthread_mutex_lock(&g_timing_lock);
+
+    HostTimings *entry = NULL;
+    for (int i = 0; i < g_host_count; i++) {
+        if (strcmp(g_hosts[i].host, host) == 0) {
+            entry = &g_hosts[i];
+            break;
+        }
+    }
+    if (!entry && g_host_count < MAX_TIMING_SERVERS) {
+        entry = &g_hosts[g_host_count++];
+        memset(entry, 0, sizeof(*entry));
+        snprintf(entry->host, sizeof(entry->host), "%s", host);
+    }
+
+    if (entry) {
+        if (entry->count == entry->capacity) {
+            int capacity = entry->capacity ? entry->capacity * 2 : 16;
+            PhaseTiming *grown = realloc(entry->samples, capacity * sizeof(PhaseTiming));
+            if (grown) {
+                entry->samples = grown;
+                entry->capacity = capacity;
+            }
+        }
+        if (entry->count < entry->capacity) {
+            entry->samples[entry->count++] = t;
+        }
+    }
+
+    pthread_mutex_unlock(&g_timing_lock);
+}
+
+// Median of one phase, selected by byte offset into PhaseTiming
+static double phase_median(const HostTimings *entry, size_t offset, int new_only, double *scratch) {
+    int n = 0;
+    for (int i = 0; i < entry->count; i++) {
+        if (new_only && !entry->samples[i].new_connection) continue;
+        scratch[n++] = *(const double *)((const char *)&entry->samples[i] + offset);
+    }
+    if (n == 0) return 0.0;
+    sort_doubles(scratch, n);
+    return (n % 2) ? scratch[n / 2] : (scratch[n / 2 - 1] + scratch[n / 2]) / 2.0;
+}
+
+int timing_get_summaries(PhaseSummary *out, int max) {
+    int written = 0;
+
+    pthread_mutex_lock(&g_timing_lock);
+
+    for (int i = 0; i < g_host_count && written < max; i++) {
+        const HostTimings *entry = &g_hosts[i];
+        double *scratch = malloc((entry->count > 0 ? entry->count : 1) * sizeof(double));
+        if (!scratch) break;
+
+        PhaseSummary *s = &out[written++];
+        memset(s, 0, sizeof(*s));
+        memcpy(s->host, entry->host, sizeof(s->host));
+        s->requests = entry->count;
+        for (int j = 0; j < entry->count; j++) {
+            s->new_connections += entry->samples[j].new_connection;
+        }
+
+        s->dns_ms = phase_median(entry, offsetof(PhaseTiming, dns_ms), 1, scratch);
+        s->tcp_ms = phase_median(entry, offsetof(PhaseTiming, tcp_ms), 1, scratch);
+        s->tls_ms = phase_median(entry, offsetof(PhaseTiming, tls_ms), 1, scratch);
+        s->wait_ms = phase_median(entry, offsetof(PhaseTiming, wait_ms), 0, scratch);
+        s->transfer_ms = phase_median(entry, offsetof(PhaseTiming, transfer_ms), 0, scratch);
+        s->total_ms = phase_median(entry, offsetof(PhaseTiming, total_ms), 0, scratch);
+
+        free(scratch);
+    }
+
+    pthread_mutex_unlock(&g_timing_lock);
+    return written;
+}
+
+void timing_reset(void) {
+    pthread_mutex_lock(&g_timing_lock);
+    for (int i = 0; i < g_host_count; i++) {
+        free(g_hosts[i].samples);
+    }
+    memset(g_hosts, 0, sizeof(g_hosts));
+    g_host_count = 0;
+    pthread_mutex_unlock(&g_timing_lock);
+}
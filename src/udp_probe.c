@@ -0,0 +1,394 @@
+#define _GNU_SOURCE
+#include "../include/udp_probe.h"
+#include "../include/analysis.h"
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PROBE_MAGIC 0x53505550u   // "SPUP"
+#define PROBE_BATCH 64
+#define PROBE_MAX_PAYLOAD 1472           // 1500 MTU - 20 IPv4 - 8 UDP
+#define PROBE_MAX_PAYLOAD_V6 1452        // 1500 MTU - 40 IPv6 - 8 UDP
+#define PROBE_SOCKET_BUFFER (4 * 1024 * 1024)
+
+// Wire format at the start of every probe (echoed back untouched)
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t send_ns;
+} ProbeHeader;
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double percentile(const double *sorted, int count, double p) {
+    if (count == 0) return 0.0;
+    int idx = (int)(p * (count - 1) + 0.5);
+    return sorted[idx];
+}
+
+// Split "host:port" or "[v6addr]:port"
+static int parse_target(const char *target, char *host, size_t host_len, char *port, size_t port_len) {
+    const char *colon;
+    if (target[0] == '[') {
+        const char *end = strchr(target, ']');
+        if (!end || end[1] != ':') return 0;
+        snprintf(host, host_len, "%.*s", (int)(end - target - 1), target + 1);
+        colon = end + 1;
+    } else {
+        colon = strrchr(target, ':');
+        if (!colon) {
+            snprintf(host, host_len, "%s", target);
+            snprintf(port, port_len, "%d", UDP_PROBE_DEFAULT_PORT);
+            return 1;
+        }
+        snprintf(host, host_len, "%.*s", (int)(colon - target), target);
+    }
+    snprintf(port, port_len, "%s", colon + 1);
+    return host[0] != '\0' && port[0] != '\0';
+}
+
+static int open_probe_socket(const char *target, int *family) {
+    char host[256], port[16];
+    if (!parse_target(target, host, sizeof(host), port, sizeof(port))) return -1;
+
+    struct addrinfo hints = {0}, *res = NULL;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0) return -1;
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            *family = ai->ai_family;
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) return -1;
+
+    int bufsize = PROBE_SOCKET_BUFFER;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    return fd;
+}
+
+// Per-probe bookkeeping while the test runs
+typedef struct {
+    double *rtt_ms;           // Indexed by sequence number, < 0 until echoed
+    uint32_t highest_seq;
+    int have_highest;
+    double last_transit_ms;
+    int have_transit;
+    UdpProbeResult *result;
+} ProbeState;
+
+static void handle_reply(ProbeState *state, const unsigned char *buf, size_t len, uint64_t now_ns) {
+    if (len < sizeof(ProbeHeader)) return;
+
+    ProbeHeader hdr;
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.magic != PROBE_MAGIC || hdr.seq >= (uint32_t)state->result->sent) return;
+
+    if (state->rtt_ms[hdr.seq] >= 0) {
+        state->result->duplicates++;
+        return;
+    }
+
+    double rtt = (double)(now_ns - hdr.send_ns) / 1000000.0;
+    state->rtt_ms[hdr.seq] = rtt;
+    state->result->received++;
+
+    if (state->have_highest && hdr.seq < state->highest_seq) {
+        state->result->reordered++;
+    } else {
+        state->highest_seq = hdr.seq;
+        state->have_highest = 1;
+    }
+
+    // RFC 3550 section 6.4.1, using the round-trip transit time
+    if (state->have_transit) {
+        double d = rtt - state->last_transit_ms;
+        if (d < 0) d = -d;
+        state->result->jitter_ms += (d - state->result->jitter_ms) / 16.0;
+    }
+    state->last_transit_ms = rtt;
+    state->have_transit = 1;
+}
+
+// Drain every reply currently queued on the socket
+static void receive_replies(int fd, ProbeState *state, unsigned char bufs[][PROBE_MAX_PAYLOAD]) {
+    struct mmsghdr msgs[PROBE_BATCH];
+    struct iovec iovs[PROBE_BATCH];
+
+    while (1) {
+        for (int i = 0; i < PROBE_BATCH; i++) {
+            iovs[i].iov_base = bufs[i];
+            iovs[i].iov_len = PROBE_MAX_PAYLOAD;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int n = recvmmsg(fd, msgs, PROBE_BATCH, MSG_DONTWAIT, NULL);
+        if (n <= 0) break;
+
+        uint64_t now = monotonic_ns();
+        for (int i = 0; i < n; i++) {
+            handle_reply(state, bufs[i], msgs[i].msg_len, now);
+        }
+        if (n < PROBE_BATCH) break;
+    }
+}
+
+UdpProbeResult run_udp_probe(const char *target, int rate_pps, double duration_s, int payload_size) {
+    UdpProbeResult result;
+    memset(&result, 0, sizeof(result));
+
+    if (rate_pps < 1) rate_pps = UDP_PROBE_DEFAULT_RATE;
+    if (duration_s <= 0) duration_s = UDP_PROBE_DEFAULT_DURATION;
+    int family = AF_UNSPEC;
+    int fd = open_probe_socket(target, &family);
+    if (fd < 0) {
+        printf("   UDP probe: cannot reach %s\n", target);
+        snprintf(result.error, sizeof(result.error), "cannot reach %.80s", target);
+        return result;
+    }
+
+    // Stay within one unfragmented datagram on a 1500-byte path
+    int max_payload = family == AF_INET6 ? PROBE_MAX_PAYLOAD_V6 : PROBE_MAX_PAYLOAD;
+    if (payload_size < (int)sizeof(ProbeHeader)) payload_size = sizeof(ProbeHeader);
+    if (payload_size > max_payload) payload_size = max_payload;
+
+    int total = (int)(rate_pps * duration_s);
+    if (total < 1) total = 1;
+
+    ProbeState state;
+    memset(&state, 0, sizeof(state));
+    state.result = &result;
+    state.rtt_ms = malloc(total * sizeof(double));
+    unsigned char (*bufs)[PROBE_MAX_PAYLOAD] = calloc(PROBE_BATCH, PROBE_MAX_PAYLOAD);
+    if (!state.rtt_ms || !bufs) {
+        free(state.rtt_ms);
+        free(bufs);
+        close(fd);
+        return result;
+    }
+    for (int i = 0; i < total; i++) state.rtt_ms[i] = -1.0;
+
+    printf("   Testing UDP (%d pps, %.0fs, %d byte probes)...", rate_pps, duration_s, payload_size);
+    fflush(stdout);
+
+    struct mmsghdr msgs[PROBE_BATCH];
+    struct iovec iovs[PROBE_BATCH];
+    uint64_t start = monotonic_ns();
+    double max_rtt_ms = 0.0;
+    int send_failed = 0;
+
+    // Paced send loop: each tick sends whatever the schedule says is due
+    while (result.sent < total) {
+        uint64_t now = monotonic_ns();
+        int due = (int)((double)(now - start) * rate_pps / 1000000000.0) + 1;
+        if (due > total) due = total;
+
+        while (result.sent < due) {
+            int batch = due - result.sent;
+            if (batch > PROBE_BATCH) batch = PROBE_BATCH;
+
+            uint64_t stamp = monotonic_ns();
+            for (int i = 0; i < batch; i++) {
+                ProbeHeader hdr = { PROBE_MAGIC, (uint32_t)(result.sent + i), stamp };
+                memset(bufs[i], 0, payload_size);
+                memcpy(bufs[i], &hdr, sizeof(hdr));
+                iovs[i].iov_base = bufs[i];
+                iovs[i].iov_len = payload_size;
+                memset(&msgs[i], 0, sizeof(msgs[i]));
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int n = sendmmsg(fd, msgs, batch, 0);
+            if (n <= 0) {
+                // Socket buffer full: drain replies and retry on the next tick
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+                    snprintf(result.error, sizeof(result.error), "send failed: %s", strerror(errno));
+                    send_failed = 1;
+                }
+                break;
+            }
+            result.sent += n;
+        }
+        if (send_failed) break;
+
+        receive_replies(fd, &state, bufs);
+
+        // Sleep until the next probe is due, waking early for replies
+        uint64_t next_due = start + (uint64_t)((double)result.sent * 1000000000.0 / rate_pps);
+        now = monotonic_ns();
+        if (next_due > now && result.sent < total) {
+            int wait_ms = (int)((next_due - now) / 1000000);
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            poll(&pfd, 1, wait_ms);
+            receive_replies(fd, &state, bufs);
+        }
+    }
+
+    // Grace period for stragglers: at least 1 s, or 3x the worst RTT seen
+    for (int i = 0; i < total; i++) {
+        if (state.rtt_ms[i] > max_rtt_ms) max_rtt_ms = state.rtt_ms[i];
+    }
+    double grace_ms = max_rtt_ms * 3.0;
+    if (grace_ms < 1000.0) grace_ms = 1000.0;
+    uint64_t deadline = monotonic_ns() + (uint64_t)(grace_ms * 1000000.0);
+
+    while (result.received < result.sent) {
+        uint64_t now = monotonic_ns();
+        if (now >= deadline) break;
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int wait_ms = (int)((deadline - now) / 1000000) + 1;
+        if (poll(&pfd, 1, wait_ms) <= 0) break;
+        receive_replies(fd, &state, bufs);
+    }
+
+    close(fd);
+
+    // Collect the RTTs of everything that came back
+    double *rtts = malloc((result.received > 0 ? result.received : 1) * sizeof(double));
+    int count = 0;
+    if (rtts) {
+        for (int i = 0; i < result.sent; i++) {
+            if (state.rtt_ms[i] >= 0) rtts[count++] = state.rtt_ms[i];
+        }
+        sort_doubles(rtts, count);
+    }
+
+    if (count > 0) {
+        result.rtt_min_ms = rtts[0];
+        result.rtt_p50_ms = percentile(rtts, count, 0.50);
+        result.rtt_p90_ms = percentile(rtts, count, 0.90);
+        result.rtt_p99_ms = percentile(rtts, count, 0.99);
+        result.rtt_max_ms = rtts[count - 1];
+    }
+    if (result.sent > 0) {
+        result.loss_percent = 100.0 * (result.sent - result.received) / result.sent;
+    }
+    // A probe cut short by a socket error does not describe the path
+    result.success = result.received > 0 && !send_failed;
+    if (!send_failed && result.received == 0) {
+        snprintf(result.error, sizeof(result.error), "received no replies");
+    }
+
+    printf(" %s\n", result.success ? "DONE" : send_failed ? "Failed" : "No replies");
+
+    free(rtts);
+    free(state.rtt_ms);
+    free(bufs);
+    return result;
+}
+
+int run_udp_echo(int port) {
+    int fd = socket(AF_INET6, SOCK_DGRAM, 0);
+    int family = AF_INET6;
+    if (fd < 0) {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        family = AF_INET;
+    }
+    if (fd < 0) {
+        perror("socket");
+        return 0;
+    }
+
+    int off = 0;
+    int bufsize = PROBE_SOCKET_BUFFER;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    memset(&addr, 0, sizeof(addr));
+    if (family == AF_INET6) {
+        // Dual-stack so IPv4 clients are served too
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&addr;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_addr = in6addr_any;
+        sin6->sin6_port = htons((uint16_t)port);
+        addr_len = sizeof(*sin6);
+    } else {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&addr;
+        sin->sin_family = AF_INET;
+        sin->sin_addr.s_addr = htonl(INADDR_ANY);
+        sin->sin_port = htons((uint16_t)port);
+        addr_len = sizeof(*sin);
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, addr_len) < 0) {
+        perror("bind");
+        close(fd);
+        return 0;
+    }
+
+    printf("UDP echo responder listening on port %d (Ctrl+C to stop)\n", port);
+    fflush(stdout);
+
+    int ok = 1;
+    static unsigned char bufs[PROBE_BATCH][PROBE_MAX_PAYLOAD];
+    struct sockaddr_storage peers[PROBE_BATCH];
+    struct mmsghdr msgs[PROBE_BATCH];
+    struct iovec iovs[PROBE_BATCH];
+
+    while (1) {
+        for (int i = 0; i < PROBE_BATCH; i++) {
+            iovs[i].iov_base = bufs[i];
+            iovs[i].iov_len = PROBE_MAX_PAYLOAD;
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &peers[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+        }
+
+        // Block for the first datagram, then take whatever else is queued
+        int n = recvmmsg(fd, msgs, PROBE_BATCH, MSG_WAITFORONE, NULL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("recvmmsg");
+            ok = 0;
+            break;
+        }
+
+        // Reflect each datagram to its sender with the same length
+        for (int i = 0; i < n; i++) {
+            iovs[i].iov_len = msgs[i].msg_len;
+        }
+        int sent = 0;
+        while (sent < n) {
+            int r = sendmmsg(fd, msgs + sent, n - sent, 0);
+            if (r <= 0) break;
+            sent += r;
+        }
+    }
+
+    close(fd);
+    return ok;
+}
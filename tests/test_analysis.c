@@ -0,0 +1,100 @@
+#include "../include/analysis.h"
+#include <stdio.h>
+
+// Fill a series sampled like measure_transfer: first sample at 0.6 s, then every 0.4 s
+static void fill(ThroughputSeries *series, double seconds, double burst_mbps,
+                 double burst_seconds, double sustained_mbps) {
+    series_init(series, 64);
+    for (double t = 0.6; t <= seconds; t += 0.4) {
+        double mbps = t <= burst_seconds ? burst_mbps : sustained_mbps;
+        series_append(series, t, mbps, (size_t)(mbps * 1000000.0 / 8.0 * 0.4));
+    }
+}
+
+// What measure_transfer asks for with the default 12 s test
+#define FLAT_SECONDS 18.0
+
+static int failures = 0;
+
+static void check(int condition, const char *what) {
+    printf("%s %s\n", condition ? "PASS" : "FAIL", what);
+    if (!condition) failures++;
+}
+
+int main(void) {
+    ThroughputSeries series;
+    BurstAnalysis burst;
+
+    // Bucket still draining at the base duration: flat, but not the line rate
+    fill(&series, 12.0, 40.0, 60.0, 10.0);
+    burst = analyze_burst(&series);
+    check(!burst.detected, "burst in progress has no change point");
+    check(!sustained_rate_established(&series, &burst, FLAT_SECONDS), "burst in progress is not established");
+    series_free(&series);
+
+    // Unshaped link: flat for the base test plus the extra time, nothing to wait for
+    fill(&series, 20.2, 40.0, 60.0, 10.0);
+    burst = analyze_burst(&series);
+    check(sustained_rate_established(&series, &burst, FLAT_SECONDS), "long flat run without a burst is established");
+    series_free(&series);
+
+    // Still changing without a clear step: keep going
+    series_init(&series, 64);
+    for (int i = 0; i < 50; i++) {
+        double mbps = (i % 2) ? 20.0 : 40.0;
+        series_append(&series, 0.6 + i * 0.4, mbps, (size_t)(mbps * 50000.0));
+    }
+    burst = analyze_burst(&series);
+    check(!sustained_rate_established(&series, &burst, FLAT_SECONDS), "noisy run without a burst is not established");
+    series_free(&series);
+
+    // Bucket emptied at 6 s, followed by 8 s of throttled rate
+    fill(&series, 14.0, 40.0, 6.0, 10.0);
+    burst = analyze_burst(&series);
+    check(burst.detected, "finished burst is detected");
+    check(burst.sustained_mbps > 9.0 && burst.sustained_mbps < 11.0, "sustained rate follows the change point");
+    check(sustained_rate_established(&series, &burst, FLAT_SECONDS), "stable post-burst tail is established");
+    series_free(&series);
+
+    // Eight 12.5 Mbps streams of a finite file finishing between 5.0 and 9.2 s:
+    // the falling staircase is not a burst, the link is 100 Mbps
+    series_init(&series, 64);
+    for (double t = 0.6; t <= 9.4; t += 0.4) {
+        int active = 0;
+        for (int s = 0; s < 8; s++) {
+            if (t <= 5.0 + s * 0.6) active++;
+        }
+        double mbps = active * 12.5;
+        series_append(&series, t, mbps, (size_t)(mbps * 1000000.0 / 8.0 * 0.4));
+    }
+    burst = analyze_transfer(&series, 1);
+    check(!burst.detected, "streams finishing one by one are not a burst");
+    check(estimate_speed(&series, 0, series.count) > 99.0, "finite transfer keeps its top-quartile rate");
+    series_free(&series);
+
+    // Variation of the probe-sized prefix drives data-budget planning
+    fill(&series, 14.0, 40.0, 6.0, 10.0);
+    check(series_variation(&series, 0, 10) < 0.001, "flat samples have no variation");
+    check(series_variation(&series, 10, 20) > 0.5, "samples across a change point vary");
+    check(series_variation(&series, 0, 2) < 0, "too few samples have no variation");
+    series_free(&series);
+
+    // Capped download that ran out at 4.6 s: seven samples past warm-up to estimate from
+    fill(&series, 4.7, 100.0, 0.0, 100.0);
+    check(series_measured_count(&series) == 7, "samples after warm-up are counted");
+    check(estimate_speed(&series, 0, series.count) == 100.0, "short capped run is estimated past warm-up");
+    series_free(&series);
+
+    // A run that ended inside the warm-up has nothing to estimate from
+    fill(&series, 1.9, 100.0, 0.0, 100.0);
+    check(series_measured_count(&series) == 0, "run inside warm-up has no measured samples");
+    series_free(&series);
+
+    // Change point too recent to trust the rate after it
+    fill(&series, 9.0, 40.0, 6.0, 10.0);
+    burst = analyze_burst(&series);
+    check(!sustained_rate_established(&series, &burst, FLAT_SECONDS), "short post-burst tail is not established");
+    series_free(&series);
+
+    return failures == 0 ? 0 : 1;
+}